@@ -0,0 +1,73 @@
+#include "headers/aligncache.hpp"
+
+#include <algorithm>
+
+AlignmentCache::AlignmentCache(size_t capacity) {
+    shard_capacity = std::max<size_t>(capacity / ALIGN_CACHE_SHARDS, 1);
+    for (Shard& shard : shards) {
+        shard.entries.reserve(shard_capacity);
+        shard.index.reserve(shard_capacity);
+    }
+}
+
+bool AlignmentCache::Find(uint64_t key, std::vector<AlignmentHit>& out) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        miss_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Entry& entry = shard.entries[found->second];
+    entry.referenced = true;
+    out.insert(out.end(), entry.hits.begin(), entry.hits.end());
+    hit_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AlignmentCache::Insert(uint64_t key, const std::vector<AlignmentHit>& hits) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        // another thread aligned the same gene in the meantime
+        shard.entries[found->second].referenced = true;
+        return;
+    }
+    if (shard.entries.size() < shard_capacity) {
+        shard.index[key] = (int)shard.entries.size();
+        shard.entries.push_back(Entry{key, hits, false});
+        return;
+    }
+    // sweep the hand, clearing reference bits until an unreferenced entry turns up
+    while (shard.entries[shard.hand].referenced) {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+    }
+    Entry& victim = shard.entries[shard.hand];
+    shard.index.erase(victim.key);
+    shard.index[key] = (int)shard.hand;
+    victim.key = key;
+    victim.hits.assign(hits.begin(), hits.end());
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+}
+
+void AlignmentCache::Clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.index.clear();
+        shard.hand = 0;
+    }
+    hit_count.store(0, std::memory_order_relaxed);
+    miss_count.store(0, std::memory_order_relaxed);
+}
+
+size_t AlignmentCache::size() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.entries.size();
+    }
+    return total;
+}
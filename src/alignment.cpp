@@ -0,0 +1,488 @@
+#include "headers/alignment.hpp"
+#include "headers/sequence.hpp"
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ALIGNMENT_X86
+#include <immintrin.h>
+#endif
+
+bool TraitDatabase::Load(const char* path, WorkerPool* workers) {
+    records.clear();
+    joined.clear();
+    total_length = 0;
+    if (!file.Open(path, workers)) {
+        return false;
+    }
+    records.reserve(file.size());
+    std::string scratch;
+    for (const FastaRecordView& record : file.Records()) {
+        std::string_view sequence = record.Sequence(scratch);
+        if (!record.single_line) {
+            joined.push_back(scratch);
+            sequence = joined.back();
+        }
+        records.push_back(TraitRecord{record.id, sequence});
+        total_length += sequence.size();
+    }
+    return true;
+}
+
+static double BitScore(int score) {
+    double raw = (double)score / ALIGN_SCORE_SCALE;
+    return (ALIGN_LAMBDA * raw - log(ALIGN_K)) / log(2.0);
+}
+
+// blast's length adjustment, the largest ell with
+// alpha / lambda * ln(K * (m - ell) * (n - N * ell)) + beta >= ell,
+// is taken off the query and every subject before the search space is used
+static double SearchSpace(size_t query_length, const TraitDatabase& database) {
+    double m = (double)query_length;
+    double n = (double)database.total_length;
+    double sequences = (double)std::max<size_t>(database.records.size(), 1);
+    auto expected = [&](double ell) {
+        return ALIGN_ALPHA / ALIGN_LAMBDA * (log(ALIGN_K) + log((m - ell) * (n - sequences * ell))) + ALIGN_BETA;
+    };
+    // the left side shrinks as ell grows, so bisect over whole lengths
+    double low = 0.0;
+    double high = floor(std::min(m, n / sequences)) - 1.0;
+    if (high < 0.0 || expected(0.0) < 0.0) {
+        high = 0.0;
+    }
+    while (low < high) {
+        double mid = ceil((low + high) / 2.0);
+        if (expected(mid) >= mid) {
+            low = mid;
+        }
+        else {
+            high = mid - 1.0;
+        }
+    }
+    return std::max(m - low, 1.0 / ALIGN_K) * std::max(n - sequences * low, 1.0);
+}
+
+// calls visit with every seed word of bases in order, 2 bits per base with
+// the first base highest. words containing anything but ACGT are skipped
+template <typename Visit>
+static void ForEachSeedWord(std::string_view bases, Visit visit) {
+    const uint32_t mask = (1u << (2 * ALIGN_SEED_LENGTH)) - 1;
+    uint32_t word = 0;
+    int valid = 0;
+    for (char base : bases) {
+        uint8_t code;
+        if (EncodeBase(base, code)) {
+            word = ((word << 2) | code) & mask;
+            valid++;
+        }
+        else {
+            valid = 0;
+        }
+        if (valid >= ALIGN_SEED_LENGTH) {
+            visit(word);
+        }
+    }
+}
+
+TraitMatcher::TraitMatcher(const TraitDatabase& database) : database(database) {
+    matrix = parasail_matrix_create("ACGTN", ALIGN_MATCH, ALIGN_MISMATCH);
+    // an ambiguous base never matches, not even another N
+    for (int i = 0; i < 5; i++) {
+        parasail_matrix_set_value(matrix, 4, i, ALIGN_MISMATCH);
+        parasail_matrix_set_value(matrix, i, 4, ALIGN_MISMATCH);
+    }
+    for (size_t s = 0; s < database.records.size(); s++) {
+        ForEachSeedWord(database.records[s].sequence, [&](uint32_t word) {
+            seeds.push_back((uint64_t)word << 32 | s);
+        });
+    }
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+}
+
+TraitMatcher::~TraitMatcher() {
+    parasail_matrix_free(matrix);
+}
+
+// lowest parasail score whose evalue can still make the cutoff
+static double MinScore(double search_space, double max_evalue) {
+    double min_bits = log2(search_space / max_evalue);
+    return (min_bits * log(2.0) + log(ALIGN_K)) / ALIGN_LAMBDA * ALIGN_SCORE_SCALE;
+}
+
+// fills in the evalues of the hits appended after first, drops the ones
+// above the cutoff and sorts the rest
+static void FinishHits(std::vector<AlignmentHit>& out, size_t first, double search_space, double max_evalue) {
+    for (size_t i = first; i < out.size();) {
+        out[i].evalue = search_space * pow(2.0, -out[i].bit_score);
+        if (out[i].evalue > max_evalue) {
+            out[i] = out.back();
+            out.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+    std::sort(out.begin() + first, out.end(), [](const AlignmentHit& a, const AlignmentHit& b) {
+        if (a.evalue != b.evalue) {
+            return a.evalue < b.evalue;
+        }
+        return a.subject < b.subject;
+    });
+}
+
+void TraitMatcher::Align(std::string_view query, std::vector<AlignmentHit>& out, double max_evalue) const {
+    if (query.empty() || database.total_length == 0) {
+        return;
+    }
+    double search_space = SearchSpace(query.size(), database);
+    double min_score = MinScore(search_space, max_evalue);
+
+    size_t first = out.size();
+    std::vector<int> subjects;
+    CollectCandidates(query, subjects);
+    AlignStrand(query, false, subjects, min_score, out);
+    std::string reverse;
+    ReverseComplement(query, reverse);
+    CollectCandidates(reverse, subjects);
+    AlignStrand(reverse, true, subjects, min_score, out);
+    FinishHits(out, first, search_space, max_evalue);
+}
+
+template<typename Vector>
+void TraitMatcher::CollectCandidates(std::string_view query, Vector& subjects) const {
+    subjects.clear();
+    ForEachSeedWord(query, [&](uint32_t word) {
+        auto it = std::lower_bound(seeds.begin(), seeds.end(), (uint64_t)word << 32);
+        for (; it != seeds.end() && (*it >> 32) == word; ++it) {
+            subjects.push_back((int)(uint32_t)*it);
+        }
+    });
+    std::sort(subjects.begin(), subjects.end());
+    subjects.erase(std::unique(subjects.begin(), subjects.end()), subjects.end());
+}
+
+void TraitMatcher::AlignStrand(std::string_view query, bool minus, const std::vector<int>& subjects, double min_score, std::vector<AlignmentHit>& out) const {
+    if (subjects.empty()) {
+        return;
+    }
+    parasail_profile_t* profile = parasail_profile_create_16(query.data(), (int)query.size(), matrix);
+    for (int s : subjects) {
+        std::string_view subject = database.records[s].sequence;
+        if (subject.empty()) {
+            continue;
+        }
+        // score only first, most traits don't come close to the cutoff
+        parasail_result_t* scored = parasail_sw_striped_profile_16(profile, subject.data(), (int)subject.size(), ALIGN_GAP_OPEN, ALIGN_GAP_EXTEND);
+        bool saturated = parasail_result_is_saturated(scored);
+        int score = parasail_result_get_score(scored);
+        parasail_result_free(scored);
+        if (saturated || score >= min_score) {
+            TraceHit(query, minus, s, saturated, min_score, out);
+        }
+    }
+    parasail_profile_free(profile);
+}
+
+void TraitMatcher::TraceHit(std::string_view query, bool minus, int s, bool saturated, double min_score, std::vector<AlignmentHit>& out) const {
+    int query_length = (int)query.size();
+    std::string_view subject = database.records[s].sequence;
+    int subject_length = (int)subject.size();
+    parasail_result_t* traced = saturated
+        ? parasail_sw_trace_striped_32(query.data(), query_length, subject.data(), subject_length, ALIGN_GAP_OPEN, ALIGN_GAP_EXTEND, matrix)
+        : parasail_sw_trace_striped_16(query.data(), query_length, subject.data(), subject_length, ALIGN_GAP_OPEN, ALIGN_GAP_EXTEND, matrix);
+    int score = parasail_result_get_score(traced);
+    parasail_cigar_t* cigar = parasail_result_get_cigar(traced, query.data(), query_length, subject.data(), subject_length, matrix);
+
+    AlignmentHit hit = {};
+    hit.subject = s;
+    int matches = 0;
+    for (int i = 0; i < cigar->len; i++) {
+        char op = parasail_cigar_decode_op(cigar->seq[i]);
+        int count = (int)parasail_cigar_decode_len(cigar->seq[i]);
+        hit.length += count;
+        if (op == '=' || op == 'M') {
+            matches += count;
+        }
+        else if (op == 'X') {
+            hit.mismatches += count;
+        }
+        else {
+            hit.gap_opens++;
+        }
+    }
+    hit.percent_identity = hit.length > 0 ? 100.0 * matches / hit.length : 0.0;
+    int query_begin = cigar->beg_query;
+    int query_end = parasail_result_get_end_query(traced);
+    int subject_begin = cigar->beg_ref;
+    int subject_end = parasail_result_get_end_ref(traced);
+    if (minus) {
+        // back to forward query positions, the subject runs backwards
+        hit.query_start = query_length - query_end;
+        hit.query_end = query_length - query_begin;
+        hit.subject_start = subject_end + 1;
+        hit.subject_end = subject_begin + 1;
+    }
+    else {
+        hit.query_start = query_begin + 1;
+        hit.query_end = query_end + 1;
+        hit.subject_start = subject_begin + 1;
+        hit.subject_end = subject_end + 1;
+    }
+    hit.bit_score = BitScore(score);
+    parasail_cigar_free(cigar);
+    parasail_result_free(traced);
+    if (score >= min_score && hit.length > 0) {
+        out.push_back(hit);
+    }
+}
+
+// residue codes of the batch kernel, pad fills the rows past the end of a
+// query shorter than the longest one in its batch
+const uint8_t BATCH_CODE_N = 4;
+const uint8_t BATCH_CODES = 5;
+const int16_t BATCH_PAD_SCORE = -16384;
+
+static uint8_t BatchCode(char base) {
+    uint8_t code;
+    return EncodeBase(base, code) ? code : BATCH_CODE_N;
+}
+
+// plain int16 arithmetic clamped like the vector instructions, so every
+// path gives the same scores and saturates at the same point
+static int16_t SaturatingAdd(int a, int b) {
+    return (int16_t)std::max(-32768, std::min(32767, a + b));
+}
+
+// best local score of every lane against the subject. profile holds the
+// score of each lane's residue in row i against code c at
+// profile[(c * rows + i) * ALIGN_BATCH_LANES + lane], h and e are scratch of
+// rows * ALIGN_BATCH_LANES
+static void BatchScoreScalar(const int16_t* profile, int rows, const uint8_t* subject, int columns, int16_t* h, int16_t* e, int16_t* best) {
+    const int lanes = ALIGN_BATCH_LANES;
+    std::fill(h, h + rows * lanes, 0);
+    std::fill(e, e + rows * lanes, -32768);
+    std::fill(best, best + lanes, 0);
+    for (int j = 0; j < columns; j++) {
+        const int16_t* scores = profile + subject[j] * rows * lanes;
+        for (int lane = 0; lane < lanes; lane++) {
+            int16_t f = -32768;
+            int16_t up = 0;
+            int16_t diag = 0;
+            for (int i = 0; i < rows; i++) {
+                int k = i * lanes + lane;
+                int16_t left = h[k];
+                e[k] = std::max(SaturatingAdd(e[k], -ALIGN_GAP_EXTEND), SaturatingAdd(left, -ALIGN_GAP_OPEN));
+                f = std::max(SaturatingAdd(f, -ALIGN_GAP_EXTEND), SaturatingAdd(up, -ALIGN_GAP_OPEN));
+                int16_t cell = std::max(std::max((int16_t)0, SaturatingAdd(diag, scores[k])), std::max(e[k], f));
+                diag = left;
+                h[k] = cell;
+                up = cell;
+                best[lane] = std::max(best[lane], cell);
+            }
+        }
+    }
+}
+
+#ifdef ALIGNMENT_X86
+__attribute__((target("avx2")))
+static void BatchScoreAVX2(const int16_t* profile, int rows, const uint8_t* subject, int columns, int16_t* h, int16_t* e, int16_t* best) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i gap_open = _mm256_set1_epi16(ALIGN_GAP_OPEN);
+    const __m256i gap_extend = _mm256_set1_epi16(ALIGN_GAP_EXTEND);
+    const __m256i lowest = _mm256_set1_epi16(-32768);
+    __m256i* hv = (__m256i*)h;
+    __m256i* ev = (__m256i*)e;
+    for (int i = 0; i < rows; i++) {
+        _mm256_storeu_si256(hv + i, zero);
+        _mm256_storeu_si256(ev + i, lowest);
+    }
+    __m256i top = zero;
+    for (int j = 0; j < columns; j++) {
+        const __m256i* scores = (const __m256i*)(profile + subject[j] * rows * ALIGN_BATCH_LANES);
+        __m256i f = lowest;
+        __m256i up = zero;
+        __m256i diag = zero;
+        for (int i = 0; i < rows; i++) {
+            __m256i left = _mm256_loadu_si256(hv + i);
+            __m256i gap_left = _mm256_max_epi16(_mm256_subs_epi16(_mm256_loadu_si256(ev + i), gap_extend), _mm256_subs_epi16(left, gap_open));
+            _mm256_storeu_si256(ev + i, gap_left);
+            f = _mm256_max_epi16(_mm256_subs_epi16(f, gap_extend), _mm256_subs_epi16(up, gap_open));
+            __m256i cell = _mm256_max_epi16(_mm256_max_epi16(zero, _mm256_adds_epi16(diag, _mm256_loadu_si256(scores + i))), _mm256_max_epi16(gap_left, f));
+            diag = left;
+            _mm256_storeu_si256(hv + i, cell);
+            up = cell;
+            top = _mm256_max_epi16(top, cell);
+        }
+    }
+    _mm256_storeu_si256((__m256i*)best, top);
+}
+#endif
+
+typedef void (*BatchScoreKernel)(const int16_t* profile, int rows, const uint8_t* subject, int columns, int16_t* h, int16_t* e, int16_t* best);
+
+static BatchScoreKernel SelectBatchScoreKernel() {
+#ifdef ALIGNMENT_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return BatchScoreAVX2;
+    }
+#endif
+    return BatchScoreScalar;
+}
+
+static const BatchScoreKernel batch_score = SelectBatchScoreKernel();
+
+const char* BatchKernelName() {
+#ifdef ALIGNMENT_X86
+    if (batch_score == BatchScoreAVX2) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+void TraitMatcher::AlignBatch(const std::vector<std::string_view>& queries, std::vector<std::vector<AlignmentHit>>& out, Arena& scratch, double max_evalue) const {
+    size_t count = queries.size();
+    out.resize(count);
+    for (std::vector<AlignmentHit>& hits : out) {
+        hits.clear();
+    }
+    if (count == 0 || database.total_length == 0) {
+        return;
+    }
+    double* search_space = scratch.Allocate<double>(count);
+    double* min_score = scratch.Allocate<double>(count);
+    std::string_view* reverse = scratch.Allocate<std::string_view>(count);
+    size_t max_rows = 0;
+    for (size_t q = 0; q < count; q++) {
+        search_space[q] = SearchSpace(std::max<size_t>(queries[q].size(), 1), database);
+        min_score[q] = MinScore(search_space[q], max_evalue);
+        char* bases = scratch.Allocate<char>(queries[q].size());
+        ReverseComplement(queries[q], bases);
+        reverse[q] = std::string_view(bases, queries[q].size());
+        max_rows = std::max(max_rows, queries[q].size());
+    }
+    size_t max_subject = 0;
+    for (const TraitRecord& record : database.records) {
+        max_subject = std::max(max_subject, record.sequence.size());
+    }
+    // sized once for the longest query and trait, every group uses a prefix
+    int16_t* profile = scratch.Allocate<int16_t>((size_t)BATCH_CODES * max_rows * ALIGN_BATCH_LANES);
+    int16_t* h = scratch.Allocate<int16_t>(max_rows * ALIGN_BATCH_LANES);
+    int16_t* e = scratch.Allocate<int16_t>(max_rows * ALIGN_BATCH_LANES);
+    uint8_t* subject_codes = scratch.Allocate<uint8_t>(max_subject);
+    ArenaVector<int> subjects{ArenaAllocator<int>(scratch)};
+    // (trait, query) for every seed hit, sorted so the queries of one trait
+    // are contiguous
+    ArenaVector<std::pair<int, int>> seeded{ArenaAllocator<std::pair<int, int>>(scratch)};
+    int16_t best[ALIGN_BATCH_LANES];
+    for (int strand = 0; strand < 2; strand++) {
+        bool minus = strand == 1;
+        auto sequence = [&](int q) {
+            return minus ? reverse[q] : queries[q];
+        };
+        seeded.clear();
+        for (size_t q = 0; q < count; q++) {
+            CollectCandidates(sequence((int)q), subjects);
+            for (int s : subjects) {
+                seeded.push_back(std::make_pair(s, (int)q));
+            }
+        }
+        // similar lengths side by side waste fewer padded rows
+        std::sort(seeded.begin(), seeded.end(), [&](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+            if (a.first != b.first) {
+                return a.first < b.first;
+            }
+            if (queries[a.second].size() != queries[b.second].size()) {
+                return queries[a.second].size() < queries[b.second].size();
+            }
+            return a.second < b.second;
+        });
+        for (size_t first = 0, last = 0; first < seeded.size(); first = last) {
+            int s = seeded[first].first;
+            for (last = first; last < seeded.size() && seeded[last].first == s; last++) {
+            }
+            std::string_view subject = database.records[s].sequence;
+            if (subject.empty()) {
+                continue;
+            }
+            for (size_t j = 0; j < subject.size(); j++) {
+                subject_codes[j] = BatchCode(subject[j]);
+            }
+            for (size_t group = first; group < last; group += ALIGN_BATCH_LANES) {
+                int lanes = (int)std::min<size_t>(ALIGN_BATCH_LANES, last - group);
+                int rows = 0;
+                for (int lane = 0; lane < lanes; lane++) {
+                    rows = std::max(rows, (int)queries[seeded[group + lane].second].size());
+                }
+                std::fill(profile, profile + (size_t)BATCH_CODES * rows * ALIGN_BATCH_LANES, BATCH_PAD_SCORE);
+                for (int lane = 0; lane < lanes; lane++) {
+                    std::string_view query = sequence(seeded[group + lane].second);
+                    for (size_t i = 0; i < query.size(); i++) {
+                        uint8_t code = BatchCode(query[i]);
+                        for (int c = 0; c < BATCH_CODES; c++) {
+                            bool match = c == code && code != BATCH_CODE_N;
+                            profile[((size_t)c * rows + i) * ALIGN_BATCH_LANES + lane] = match ? ALIGN_MATCH : ALIGN_MISMATCH;
+                        }
+                    }
+                }
+                batch_score(profile, rows, subject_codes, (int)subject.size(), h, e, best);
+                for (int lane = 0; lane < lanes; lane++) {
+                    int q = seeded[group + lane].second;
+                    // a lane at the int16 ceiling has lost its true score, parasail redoes it in 32 bits
+                    bool saturated = best[lane] >= 32767 - ALIGN_MATCH;
+                    if (saturated || best[lane] >= min_score[q]) {
+                        TraceHit(sequence(q), minus, s, saturated, min_score[q], out[q]);
+                    }
+                }
+            }
+        }
+    }
+    for (size_t q = 0; q < count; q++) {
+        FinishHits(out[q], 0, search_space[q], max_evalue);
+    }
+}
+
+std::string TraitMatcher::Format(std::string_view query_id, const AlignmentHit& hit) const {
+    // same number formats as blast's tabular output
+    char evalue[32];
+    if (hit.evalue < 1.0e-180) {
+        snprintf(evalue, sizeof(evalue), "0.0");
+    }
+    else if (hit.evalue < 1.0e-99) {
+        snprintf(evalue, sizeof(evalue), "%.0e", hit.evalue);
+    }
+    else if (hit.evalue < 0.0009) {
+        snprintf(evalue, sizeof(evalue), "%.2e", hit.evalue);
+    }
+    else if (hit.evalue < 0.1) {
+        snprintf(evalue, sizeof(evalue), "%.3f", hit.evalue);
+    }
+    else if (hit.evalue < 1.0) {
+        snprintf(evalue, sizeof(evalue), "%.2f", hit.evalue);
+    }
+    else if (hit.evalue < 10.0) {
+        snprintf(evalue, sizeof(evalue), "%.1f", hit.evalue);
+    }
+    else {
+        snprintf(evalue, sizeof(evalue), "%.0f", hit.evalue);
+    }
+    char bits[32];
+    if (hit.bit_score > 99999.0) {
+        snprintf(bits, sizeof(bits), "%.3e", hit.bit_score);
+    }
+    else if (hit.bit_score > 99.9) {
+        snprintf(bits, sizeof(bits), "%ld", (long)hit.bit_score);
+    }
+    else {
+        snprintf(bits, sizeof(bits), "%.1f", hit.bit_score);
+    }
+    char line[512];
+    snprintf(line, sizeof(line), "%.*s\t%.*s\t%.3f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\t%s",
+        (int)query_id.size(), query_id.data(), (int)database.records[hit.subject].id.size(), database.records[hit.subject].id.data(),
+        hit.percent_identity, hit.length, hit.mismatches, hit.gap_opens,
+        hit.query_start, hit.query_end, hit.subject_start, hit.subject_end, evalue, bits);
+    return line;
+}
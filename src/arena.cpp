@@ -0,0 +1,65 @@
+#include "headers/arena.hpp"
+
+#include <new>
+#include <algorithm>
+
+Arena::Arena(size_t block_size) {
+    AddBlock(block_size);
+}
+
+Arena::~Arena() {
+    for (Block& block : blocks) {
+        ::operator delete(block.data, std::align_val_t(ARENA_BLOCK_ALIGNMENT));
+    }
+}
+
+void Arena::AddBlock(size_t size) {
+    blocks.push_back(Block{(char*)::operator new(size, std::align_val_t(ARENA_BLOCK_ALIGNMENT)), size});
+    capacity += size;
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    size_t start = (offset + alignment - 1) & ~(alignment - 1);
+    if (start + size > blocks.back().size) {
+        used += offset;
+        // doubling keeps the number of blocks in one tick logarithmic
+        AddBlock(std::max(blocks.back().size * 2, size + alignment));
+        start = 0;
+    }
+    offset = start + size;
+    return blocks.back().data + start;
+}
+
+void Arena::Reset() {
+    if (blocks.size() > 1) {
+        size_t total = capacity;
+        for (Block& block : blocks) {
+            ::operator delete(block.data, std::align_val_t(ARENA_BLOCK_ALIGNMENT));
+        }
+        blocks.clear();
+        capacity = 0;
+        AddBlock(total);
+    }
+    offset = 0;
+    used = 0;
+}
+
+TickArenas::TickArenas(int threads) {
+    for (int i = 0; i < threads; i++) {
+        arenas.push_back(std::make_unique<Arena>());
+    }
+}
+
+void TickArenas::Reset() {
+    for (std::unique_ptr<Arena>& arena : arenas) {
+        arena->Reset();
+    }
+}
+
+size_t TickArenas::Capacity() const {
+    size_t total = 0;
+    for (const std::unique_ptr<Arena>& arena : arenas) {
+        total += arena->Capacity();
+    }
+    return total;
+}
@@ -0,0 +1,128 @@
+#include "headers/conjugation.hpp"
+
+#include <algorithm>
+
+static void AtomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+ConjugationPlanner::ConjugationPlanner(int columns, int rows, float cell_width, float cell_height)
+    : grid(columns, rows, cell_width, cell_height) {}
+
+void ConjugationPlanner::Clear() {
+    grid.Clear();
+    entities.clear();
+    plasmids.clear();
+}
+
+int ConjugationPlanner::Add(uint64_t entity, const SDL_FRect& rect, int plasmid_count) {
+    int slot = (int)entities.size();
+    grid.Insert(slot, rect);
+    entities.push_back(entity);
+    plasmids.push_back(plasmid_count);
+    return slot;
+}
+
+void ConjugationPlanner::Plan(WorkerPool& workers, TickArenas& arenas, const CounterRng& rng, uint64_t tick, std::vector<PlasmidTransfer>& out) {
+    out.clear();
+    grid.Build();
+    int count = (int)entities.size();
+    Arena& arena = arenas.Main();
+    // every thread collects into its own arena
+    ArenaVector<ArenaVector<Pair>> found{ArenaAllocator<ArenaVector<Pair>>(arena)};
+    found.reserve(workers.ThreadCount());
+    for (int thread = 0; thread < workers.ThreadCount(); thread++) {
+        found.emplace_back(ArenaAllocator<Pair>(arenas.Thread(thread)));
+    }
+    workers.ParallelFor(count, CONJUGATION_RANGE, [&](int begin, int end, int thread) {
+        ArenaVector<Pair>& local = found[thread];
+        // walking the grid in cell order keeps consecutive queries on the same cells
+        for (int e = begin; e < end; e++) {
+            int s = (int)grid[e].id;
+            grid.Query(grid[e].rect, [&](const SpatialGrid::Entry& entry) {
+                int o = (int)entry.id;
+                // every pair is seen from both sides, the lower slot keeps it
+                if (o <= s) {
+                    return;
+                }
+                bool s_gives = plasmids[s] > 0 && plasmids[o] < CONJUGATION_MAX_PLASMIDS;
+                bool o_gives = plasmids[o] > 0 && plasmids[s] < CONJUGATION_MAX_PLASMIDS;
+                if (!s_gives && !o_gives) {
+                    return;
+                }
+                uint64_t low = std::min(entities[s], entities[o]);
+                uint64_t high = std::max(entities[s], entities[o]);
+                RngBlock r = rng.Block(RngStream::CONJUGATION, tick, (low & 0xFFFFFFFF) << 32 | (high & 0xFFFFFFFF));
+                if (UniformFloat(r.w[0]) >= CONJUGATION_CHANCE) {
+                    return;
+                }
+                // when both could give, a coin decides which way the plasmid goes
+                bool s_donor = s_gives && (!o_gives || (r.w[1] & 1));
+                local.push_back(Pair{s_donor ? s : o, s_donor ? o : s, r.w[1] >> 1, (uint64_t)r.w[2] << 32});
+            });
+        }
+    });
+    size_t total = 0;
+    for (const ArenaVector<Pair>& local : found) {
+        total += local.size();
+    }
+    ArenaVector<Pair> pairs{ArenaAllocator<Pair>(arena)};
+    pairs.reserve(total);
+    for (const ArenaVector<Pair>& local : found) {
+        pairs.insert(pairs.end(), local.begin(), local.end());
+    }
+    auto key = [](const Pair& pair) {
+        return std::make_pair(std::min(pair.donor, pair.recipient), std::max(pair.donor, pair.recipient));
+    };
+    std::sort(pairs.begin(), pairs.end(), [&](const Pair& a, const Pair& b) {
+        return key(a) < key(b);
+    });
+    // the index in the low bits makes priorities unique, so no two pairs
+    // sharing an organism can both win
+    for (size_t i = 0; i < pairs.size(); i++) {
+        pairs[i].priority |= i;
+    }
+    sampled = pairs.size();
+
+    if (best_capacity < (size_t)count) {
+        best_capacity = std::max((size_t)count, best_capacity * 2);
+        best.reset(new std::atomic<uint64_t>[best_capacity]);
+    }
+    ArenaVector<uint8_t> matched(count, 0, ArenaAllocator<uint8_t>(arena));
+    ArenaVector<uint8_t> won{ArenaAllocator<uint8_t>(arena)};
+    won.reserve(pairs.size());
+    for (int round = 0; round < CONJUGATION_ROUNDS && !pairs.empty(); round++) {
+        int pair_count = (int)pairs.size();
+        workers.ParallelFor(pair_count, CONJUGATION_RANGE, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                best[pairs[i].donor].store(0, std::memory_order_relaxed);
+                best[pairs[i].recipient].store(0, std::memory_order_relaxed);
+            }
+        });
+        workers.ParallelFor(pair_count, CONJUGATION_RANGE, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                AtomicMax(best[pairs[i].donor], pairs[i].priority);
+                AtomicMax(best[pairs[i].recipient], pairs[i].priority);
+            }
+        });
+        won.assign(pair_count, 0);
+        workers.ParallelFor(pair_count, CONJUGATION_RANGE, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                const Pair& pair = pairs[i];
+                won[i] = best[pair.donor].load(std::memory_order_relaxed) == pair.priority && best[pair.recipient].load(std::memory_order_relaxed) == pair.priority;
+            }
+        });
+        for (int i = 0; i < pair_count; i++) {
+            if (won[i]) {
+                out.push_back(PlasmidTransfer{pairs[i].donor, pairs[i].recipient, pairs[i].choice});
+                matched[pairs[i].donor] = 1;
+                matched[pairs[i].recipient] = 1;
+            }
+        }
+        pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](const Pair& pair) {
+            return matched[pair.donor] || matched[pair.recipient];
+        }), pairs.end());
+    }
+}
@@ -0,0 +1,141 @@
+#include "headers/currents.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CURRENTS_X86
+#include <immintrin.h>
+#endif
+
+// every kernel sums in the same order so all of them produce identical results
+static void DiffuseRowScalar(const float* up, const float* row, const float* down, float* out, int width) {
+    for (int i = 1; i < width - 1; i++) {
+        out[i] = ((row[i - 1] + row[i + 1]) + (up[i] + down[i])) * 0.25f;
+    }
+}
+
+#ifdef CURRENTS_X86
+__attribute__((target("sse2")))
+static void DiffuseRowSSE2(const float* up, const float* row, const float* down, float* out, int width) {
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    int i = 1;
+    for (; i + 4 <= width - 1; i += 4) {
+        __m128 horizontal = _mm_add_ps(_mm_loadu_ps(row + i - 1), _mm_loadu_ps(row + i + 1));
+        __m128 vertical = _mm_add_ps(_mm_loadu_ps(up + i), _mm_loadu_ps(down + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(horizontal, vertical), quarter));
+    }
+    for (; i < width - 1; i++) {
+        out[i] = ((row[i - 1] + row[i + 1]) + (up[i] + down[i])) * 0.25f;
+    }
+}
+
+__attribute__((target("avx2")))
+static void DiffuseRowAVX2(const float* up, const float* row, const float* down, float* out, int width) {
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    int i = 1;
+    for (; i + 8 <= width - 1; i += 8) {
+        __m256 horizontal = _mm256_add_ps(_mm256_loadu_ps(row + i - 1), _mm256_loadu_ps(row + i + 1));
+        __m256 vertical = _mm256_add_ps(_mm256_loadu_ps(up + i), _mm256_loadu_ps(down + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(horizontal, vertical), quarter));
+    }
+    for (; i < width - 1; i++) {
+        out[i] = ((row[i - 1] + row[i + 1]) + (up[i] + down[i])) * 0.25f;
+    }
+}
+#endif
+
+DiffuseRowKernel SelectDiffuseKernel() {
+#ifdef CURRENTS_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return DiffuseRowAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return DiffuseRowSSE2;
+    }
+#endif
+    return DiffuseRowScalar;
+}
+
+const char* DiffuseKernelName() {
+    DiffuseRowKernel kernel = SelectDiffuseKernel();
+#ifdef CURRENTS_X86
+    if (kernel == DiffuseRowAVX2) {
+        return "avx2";
+    }
+    if (kernel == DiffuseRowSSE2) {
+        return "sse2";
+    }
+#endif
+    return kernel == DiffuseRowScalar ? "scalar" : "unknown";
+}
+
+static const DiffuseRowKernel diffuse_row = SelectDiffuseKernel();
+
+// smallest band handed to a worker, below this the wake up costs more than the rows
+const int DIFFUSE_BAND_ROWS = 16;
+
+// average of whichever of the four neighbours exist, used for the peeled border cells
+static float DiffuseBorderCell(const float* plane, int width, int height, int x, int y) {
+    int i = x + y * width;
+    float sum = 0;
+    int neighbors = 0;
+    if (x > 0) {
+        sum += plane[i - 1];
+        neighbors++;
+    }
+    if (x + 1 < width) {
+        sum += plane[i + 1];
+        neighbors++;
+    }
+    if (y > 0) {
+        sum += plane[i - width];
+        neighbors++;
+    }
+    if (y + 1 < height) {
+        sum += plane[i + width];
+        neighbors++;
+    }
+    return neighbors > 0 ? sum / neighbors : plane[i];
+}
+
+static void DiffusePlaneRows(const float* src, float* dst, int width, int height, int row_begin, int row_end) {
+    if (width <= 0) {
+        return;
+    }
+    for (int y = row_begin; y < row_end; y++) {
+        float* out = dst + y * width;
+        if (y == 0 || y == height - 1) {
+            for (int x = 0; x < width; x++) {
+                out[x] = DiffuseBorderCell(src, width, height, x, y);
+            }
+            continue;
+        }
+        const float* row = src + y * width;
+        diffuse_row(row - width, row, row + width, out, width);
+        out[0] = DiffuseBorderCell(src, width, height, 0, y);
+        out[width - 1] = DiffuseBorderCell(src, width, height, width - 1, y);
+    }
+}
+
+CurrentField::CurrentField(int w, int h) : width(w), height(h), front(0) {
+    for (int i = 0; i < 2; i++) {
+        x[i].resize(w * h);
+        y[i].resize(w * h);
+    }
+}
+
+void CurrentField::Diffuse() {
+    DiffuseRows(0, height);
+    Swap();
+}
+
+void CurrentField::Diffuse(WorkerPool& workers) {
+    workers.ParallelFor(height, DIFFUSE_BAND_ROWS, [this](int begin, int end, int) {
+        DiffuseRows(begin, end);
+    });
+    Swap();
+}
+
+void CurrentField::DiffuseRows(int row_begin, int row_end) {
+    int back = front ^ 1;
+    DiffusePlaneRows(x[front].data(), x[back].data(), width, height, row_begin, row_end);
+    DiffusePlaneRows(y[front].data(), y[back].data(), width, height, row_begin, row_end);
+}
@@ -0,0 +1,127 @@
+#include "headers/expression.hpp"
+#include "headers/translation.hpp"
+
+#include <algorithm>
+
+// index of the first site of fragment at or after position
+static size_t LowerSite(const std::vector<MotifSite>& sites, int fragment, size_t position) {
+    auto it = std::lower_bound(sites.begin(), sites.end(), std::make_pair(fragment, position), [](const MotifSite& site, const std::pair<int, size_t>& key) {
+        return site.fragment < key.first || (site.fragment == key.first && site.position < key.second);
+    });
+    return it - sites.begin();
+}
+
+static void ComputeGene(const Genome& genome, const std::vector<MotifSite>& sites, ExpressedGene& gene, Arena& scratch) {
+    float promotion = EXPRESSION_BASAL;
+    float inhibition = 1;
+    for (size_t i = LowerSite(sites, gene.fragment, gene.DependencyStart()); i < sites.size(); i++) {
+        const MotifSite& site = sites[i];
+        if (site.fragment != gene.fragment || site.position >= gene.end) {
+            break;
+        }
+        if (site.kind == MotifKind::PROMOTER) {
+            promotion += site.weight;
+        }
+        else {
+            inhibition *= 1 - site.weight;
+        }
+    }
+    gene.level = std::min(promotion, 1.0f) * inhibition;
+    const PackedSequence& sequence = *genome.fragments[gene.fragment].nucleotides;
+    // translated in place, the protein only lives until the profile is taken
+    char* protein = scratch.Allocate<char>((gene.end - gene.start) / 3);
+    size_t length = TranslateRange(sequence, gene.start, gene.end, 0, protein);
+    gene.profile = ComputeProfile(std::string_view(protein, length));
+    gene.revision++;
+}
+
+Expression Express(const Genome& genome, const MotifScanner& motifs, Arena& scratch) {
+    Expression expression;
+    for (size_t f = 0; f < genome.fragments.size(); f++) {
+        const PackedSequence& sequence = *genome.fragments[f].nucleotides;
+        motifs.Scan(sequence, (int)f, expression.sites, scratch);
+        expression.genes.push_back(ExpressedGene{(int)f, 0, sequence.size(), 0, {}, {}, 0});
+    }
+    for (size_t g = 0; g < expression.genes.size(); g++) {
+        ComputeGene(genome, expression.sites, expression.genes[g], scratch);
+        expression.unmatched.push_back((int)g);
+    }
+    return expression;
+}
+
+void Mutate(Genome& genome, Expression& expression, const MotifScanner& motifs, const Mutation& mutation, Arena& scratch) {
+    int fragment = mutation.fragment;
+    // copies the fragment if the genome still shares it with a relative
+    PackedSequence& sequence = genome.fragments[fragment].nucleotides.Mutable();
+    size_t old_size = sequence.size();
+    size_t position = std::min(mutation.position, sequence.size());
+    size_t removed = std::min(mutation.removed, sequence.size() - position);
+    size_t inserted = mutation.inserted.size();
+    if (removed == 1 && inserted == 1) {
+        sequence.Substitute(position, mutation.inserted[0]);
+    }
+    else {
+        if (removed > 0) {
+            sequence.Erase(position, removed);
+        }
+        if (inserted > 0) {
+            sequence.Insert(position, mutation.inserted);
+        }
+    }
+    // old coordinates past the removed bases move by the change in length,
+    // ones inside them collapse onto the edit
+    auto shift = [&](size_t x) {
+        return x <= position ? x : x >= position + removed ? x + inserted - removed : position;
+    };
+
+    // sites starting in [low, position + removed) may overlap the edit, they
+    // are found again by scanning just the neighbourhood of the new bases
+    size_t reach = std::max(motifs.MaxLength() - 1, 0);
+    size_t low = position > reach ? position - reach : 0;
+    std::vector<MotifSite>& sites = expression.sites;
+    size_t first = LowerSite(sites, fragment, low);
+    size_t last = LowerSite(sites, fragment, position + removed);
+    for (size_t i = last; i < sites.size() && sites[i].fragment == fragment; i++) {
+        sites[i].position = sites[i].position + inserted - removed;
+    }
+    // the rescan lands at the back of sites and is rotated into place, so
+    // no temporary list is needed
+    size_t end = sites.size();
+    motifs.Scan(sequence, fragment, low, position + inserted + reach, sites, scratch);
+    // the ones starting after the new bases were already there, shifted above
+    sites.erase(std::remove_if(sites.begin() + end, sites.end(), [&](const MotifSite& site) {
+        return site.position >= position + inserted;
+    }), sites.end());
+    std::rotate(sites.begin() + first, sites.begin() + end, sites.end());
+    size_t found = sites.size() - end;
+    sites.erase(sites.begin() + first + found, sites.begin() + last + found);
+
+    for (size_t g = 0; g < expression.genes.size(); g++) {
+        ExpressedGene& gene = expression.genes[g];
+        if (gene.fragment != fragment) {
+            continue;
+        }
+        // a gene running to the end of the fragment takes in bases appended there
+        bool tail = gene.end == old_size;
+        bool coding = (position < gene.end || (tail && inserted > 0)) && position + std::max<size_t>(removed, 1) > gene.start;
+        bool regulated = low < gene.end && position + removed >= gene.DependencyStart();
+        gene.start = shift(gene.start);
+        gene.end = tail ? sequence.size() : shift(gene.end);
+        if (coding || regulated) {
+            ComputeGene(genome, sites, gene, scratch);
+            if (std::find(expression.unmatched.begin(), expression.unmatched.end(), (int)g) == expression.unmatched.end()) {
+                expression.unmatched.push_back((int)g);
+            }
+        }
+    }
+}
+
+void AddFragment(Genome& genome, Expression& expression, const MotifScanner& motifs, const GenomeFragment& fragment, Arena& scratch) {
+    int f = (int)genome.fragments.size();
+    genome.fragments.push_back(fragment);
+    // the new fragment has the highest index, so its sites go last
+    motifs.Scan(*fragment.nucleotides, f, expression.sites, scratch);
+    expression.genes.push_back(ExpressedGene{f, 0, fragment.nucleotides->size(), 0, {}, {}, 0});
+    ComputeGene(genome, expression.sites, expression.genes.back(), scratch);
+    expression.unmatched.push_back((int)expression.genes.size() - 1);
+}
@@ -0,0 +1,182 @@
+#include "headers/fasta.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool MappedFile::Open(const char* path) {
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length)) {
+        CloseHandle(file);
+        return false;
+    }
+    // an empty file can't be mapped, it's just an empty view
+    if (length.QuadPart == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    // the mapping keeps its own reference to the file
+    HANDLE file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (file_mapping == nullptr) {
+        return false;
+    }
+    void* view = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(file_mapping);
+        return false;
+    }
+    mapping = file_mapping;
+    data = (const char*)view;
+    size = (size_t)length.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    data = (const char*)view;
+    size = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        munmap((void*)data, size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+}
+
+static bool IsLineSpace(char c) {
+    return c == '\n' || c == '\r' || c == ' ' || c == '\t';
+}
+
+std::string_view FastaRecordView::Sequence(std::string& scratch) const {
+    if (single_line) {
+        return body;
+    }
+    scratch.clear();
+    scratch.reserve(body.size());
+    for (size_t i = 0; i < body.size();) {
+        const char* newline = (const char*)memchr(body.data() + i, '\n', body.size() - i);
+        size_t end = newline != nullptr ? newline - body.data() : body.size();
+        size_t line_end = end;
+        while (line_end > i && IsLineSpace(body[line_end - 1])) {
+            line_end--;
+        }
+        scratch.append(body.data() + i, line_end - i);
+        i = end + 1;
+    }
+    return scratch;
+}
+
+// offsets of the '>' of every record starting in [begin, end), a range can
+// start mid line, a record only starts at the beginning of one
+static void FindRecordStarts(std::string_view text, size_t begin, size_t end, std::vector<size_t>& starts) {
+    size_t i = begin;
+    while (i < end) {
+        if (text[i] == '>' && (i == 0 || text[i - 1] == '\n')) {
+            starts.push_back(i);
+        }
+        const char* newline = (const char*)memchr(text.data() + i, '\n', text.size() - i);
+        if (newline == nullptr) {
+            break;
+        }
+        i = newline - text.data() + 1;
+    }
+}
+
+// the record from start up to next
+static FastaRecordView ParseRecord(std::string_view text, size_t start, size_t next) {
+    std::string_view record = text.substr(start, next - start);
+    size_t line_end = std::min(record.find('\n'), record.size());
+    FastaRecordView view;
+    view.header = record.substr(1, line_end - 1);
+    while (!view.header.empty() && view.header.back() == '\r') {
+        view.header.remove_suffix(1);
+    }
+    view.id = view.header.substr(0, std::min(view.header.find_first_of(" \t"), view.header.size()));
+    view.body = record.substr(std::min(line_end + 1, record.size()));
+    while (!view.body.empty() && IsLineSpace(view.body.back())) {
+        view.body.remove_suffix(1);
+    }
+    view.single_line = view.body.find('\n') == std::string_view::npos;
+    return view;
+}
+
+bool FastaFile::Open(const char* path, WorkerPool* workers) {
+    records.clear();
+    if (!file.Open(path)) {
+        return false;
+    }
+    std::string_view text = file.View();
+    std::vector<size_t> starts;
+    if (workers != nullptr && workers->ThreadCount() > 1 && text.size() > FASTA_INDEX_CHUNK) {
+        // every chunk collects its own starts, joined in chunk order they
+        // are in file order
+        int tasks = (int)((text.size() + FASTA_INDEX_CHUNK - 1) / FASTA_INDEX_CHUNK);
+        std::vector<std::vector<size_t>> found(tasks);
+        workers->Run(tasks, [&](int task, int) {
+            size_t begin = (size_t)task * FASTA_INDEX_CHUNK;
+            FindRecordStarts(text, begin, std::min(begin + FASTA_INDEX_CHUNK, text.size()), found[task]);
+        });
+        for (const std::vector<size_t>& chunk : found) {
+            starts.insert(starts.end(), chunk.begin(), chunk.end());
+        }
+    }
+    else {
+        FindRecordStarts(text, 0, text.size(), starts);
+    }
+
+    int count = (int)starts.size();
+    records.resize(count);
+    auto parse = [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++) {
+            records[i] = ParseRecord(text, starts[i], i + 1 < count ? starts[i + 1] : text.size());
+        }
+    };
+    if (workers != nullptr && count > 0) {
+        workers->ParallelFor(count, FASTA_PARSE_RANGE, parse);
+    }
+    else {
+        parse(0, count, 0);
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alignment.hpp"
+
+const int ALIGN_CACHE_SHARDS = 16;
+// genes remembered across all shards
+const size_t ALIGN_CACHE_CAPACITY = 1 << 14;
+
+// trait hits of recently aligned genes keyed by PackedSequence::Hash. every
+// shard is a fixed ring of entries evicted with the CLOCK second chance
+// scheme under its own lock, so threads rarely wait on each other
+class AlignmentCache {
+public:
+    explicit AlignmentCache(size_t capacity = ALIGN_CACHE_CAPACITY);
+    AlignmentCache(const AlignmentCache&) = delete;
+    AlignmentCache& operator=(const AlignmentCache&) = delete;
+
+    // appends the cached hits to out, false (and out untouched) on a miss
+    bool Find(uint64_t key, std::vector<AlignmentHit>& out);
+    void Insert(uint64_t key, const std::vector<AlignmentHit>& hits);
+    void Clear();
+
+    uint64_t Hits() const { return hit_count.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return miss_count.load(std::memory_order_relaxed); }
+    size_t size();
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::vector<AlignmentHit> hits;
+        bool referenced;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+        std::unordered_map<uint64_t, int> index;
+        size_t hand = 0;
+    };
+
+    Shard& ShardFor(uint64_t key) { return shards[(key >> 32) % ALIGN_CACHE_SHARDS]; }
+
+    size_t shard_capacity;
+    Shard shards[ALIGN_CACHE_SHARDS];
+    std::atomic<uint64_t> hit_count{0};
+    std::atomic<uint64_t> miss_count{0};
+};
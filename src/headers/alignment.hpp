@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "parasail.h"
+#include "fasta.hpp"
+#include "arena.hpp"
+
+// megablast scoring doubled so the 2.5 per base gap cost is an integer,
+// raw scores are halved again before the statistics
+const int ALIGN_MATCH = 2;
+const int ALIGN_MISMATCH = -4;
+const int ALIGN_GAP_OPEN = 5;
+const int ALIGN_GAP_EXTEND = 5;
+const int ALIGN_SCORE_SCALE = 2;
+// karlin-altschul parameters blast uses for reward 1 penalty -2, alpha and
+// beta drive the length adjustment of the search space
+const double ALIGN_LAMBDA = 1.28;
+const double ALIGN_K = 0.46;
+const double ALIGN_ALPHA = 1.5;
+const double ALIGN_BETA = -2.0;
+// blastn's default cutoff
+const double ALIGN_MAX_EVALUE = 10.0;
+// queries the batch kernel scores side by side, one per 16 bit lane of an avx2 register
+const int ALIGN_BATCH_LANES = 16;
+// word size of the seed index, a trait is only aligned once it shares an
+// exact word of this many bases with the query
+const int ALIGN_SEED_LENGTH = 11;
+
+// one row of blast's tabular output (-outfmt 6), positions are 1 based and
+// a hit on the minus strand has subject_start > subject_end
+struct AlignmentHit {
+    int subject;             // index into the trait database
+    double percent_identity;
+    int length;
+    int mismatches;
+    int gap_opens;
+    int query_start;
+    int query_end;
+    int subject_start;
+    int subject_end;
+    double evalue;
+    double bit_score;
+};
+
+struct TraitRecord {
+    std::string_view id;
+    std::string_view sequence;
+};
+
+// the trait sequences genes are matched against, loaded once at startup.
+// records point straight into the mapped file, only records split over
+// several lines are joined into a copy
+struct TraitDatabase {
+    bool Load(const char* path, WorkerPool* workers = nullptr);
+
+    std::vector<TraitRecord> records;
+    size_t total_length = 0;
+
+private:
+    FastaFile file;
+    std::deque<std::string> joined;
+};
+
+// aligns genes against the traits with parasail's striped smith-waterman.
+// the traits sharing a seed word with the query are scored against a query
+// profile first and only the ones that can pass the evalue cutoff get a
+// traceback. Align only reads shared state, so one matcher can serve every
+// thread
+class TraitMatcher {
+public:
+    explicit TraitMatcher(const TraitDatabase& database);
+    ~TraitMatcher();
+    TraitMatcher(const TraitMatcher&) = delete;
+    TraitMatcher& operator=(const TraitMatcher&) = delete;
+
+    // appends the best hit per seeded trait and strand, sorted by evalue
+    void Align(std::string_view query, std::vector<AlignmentHit>& out, double max_evalue = ALIGN_MAX_EVALUE) const;
+
+    // aligns many genes at once, out[i] gets what Align would append for
+    // queries[i]. instead of parasail's profile the scores come from an
+    // inter-sequence kernel running 16 queries against the same trait, one
+    // per lane, which keeps every lane busy however short the genes are.
+    // the working buffers come from scratch and are dead once this returns
+    void AlignBatch(const std::vector<std::string_view>& queries, std::vector<std::vector<AlignmentHit>>& out, Arena& scratch, double max_evalue = ALIGN_MAX_EVALUE) const;
+
+    // a hit as the tab separated outfmt 6 line, without the newline
+    std::string Format(std::string_view query_id, const AlignmentHit& hit) const;
+
+    const TraitDatabase& Database() const { return database; }
+    size_t SeedCount() const { return seeds.size(); }
+
+private:
+    // sorted, unique indices of the traits sharing at least one seed word with query
+    template<typename Vector>
+    void CollectCandidates(std::string_view query, Vector& subjects) const;
+    void AlignStrand(std::string_view query, bool minus, const std::vector<int>& subjects, double min_score, std::vector<AlignmentHit>& out) const;
+    // runs parasail's traceback of query against trait s and appends the hit if it makes min_score
+    void TraceHit(std::string_view query, bool minus, int s, bool saturated, double min_score, std::vector<AlignmentHit>& out) const;
+
+    const TraitDatabase& database;
+    parasail_matrix_t* matrix;
+    // every word of the database as word << 32 | trait, sorted and unique
+    std::vector<uint64_t> seeds;
+};
+
+const char* BatchKernelName();
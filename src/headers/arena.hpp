@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// size of an arena's first block
+const size_t ARENA_BLOCK_SIZE = 1 << 20;
+// every block starts on this boundary, enough for any avx2 load
+const size_t ARENA_BLOCK_ALIGNMENT = 64;
+
+// linear allocator for data that lives until the next Reset. allocating is a
+// pointer bump and nothing is ever freed on its own. a tick that outgrows the
+// block chains on bigger ones, and Reset folds them into one block that fits
+// the whole tick, so once the sizes settle a tick never reaches malloc
+class Arena {
+public:
+    explicit Arena(size_t block_size = ARENA_BLOCK_SIZE);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    // uninitialized room for count objects of T, only for T that need no destructor
+    template<typename T>
+    T* Allocate(size_t count) {
+        return (T*)Allocate(count * sizeof(T), alignof(T));
+    }
+    // takes back everything allocated since the last Reset
+    void Reset();
+
+    // bytes handed out since the last Reset, counting alignment padding
+    size_t Used() const { return used + offset; }
+    size_t Capacity() const { return capacity; }
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    void AddBlock(size_t size);
+
+    std::vector<Block> blocks;  // allocations come from the last one
+    size_t offset = 0;          // into the last block
+    size_t used = 0;            // bytes of the blocks before the last
+    size_t capacity = 0;
+};
+
+// standard allocator on top of an arena so containers can live in it.
+// deallocating does nothing, the memory comes back with the next Reset, so a
+// container must not be used past that
+template<typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return arena->Allocate<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// one arena per worker pool thread, all reset together after every
+// world.progress(). thread 0 is the main thread, which the systems run on
+class TickArenas {
+public:
+    explicit TickArenas(int threads);
+
+    Arena& Main() { return *arenas[0]; }
+    Arena& Thread(int thread) { return *arenas[thread]; }
+    void Reset();
+    size_t Capacity() const;
+
+private:
+    std::vector<std::unique_ptr<Arena>> arenas;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "SDL3/SDL.h"
+#include "spatial.hpp"
+#include "rng.hpp"
+#include "workers.hpp"
+#include "arena.hpp"
+
+// chance per tick that two touching organisms conjugate, if one of them has
+// a plasmid to give
+const float CONJUGATION_CHANCE = 0.05f;
+// a genome with this many plasmids takes up no more
+const int CONJUGATION_MAX_PLASMIDS = 8;
+// matching rounds per tick, every round pairs up organisms whose pairs lost
+// to a neighbour in the round before
+const int CONJUGATION_ROUNDS = 4;
+// organisms whose neighbourhood one task searches
+const int CONJUGATION_RANGE = 1024;
+
+struct PlasmidTransfer {
+    int donor;          // slots, see ConjugationPlanner::Add
+    int recipient;
+    uint32_t choice;    // random bits for picking one of the donor's plasmids
+};
+
+// plans the plasmid transfers of a tick: finds the touching organisms with a
+// spatial grid, samples which pairs conjugate and matches them so that no
+// organism takes part in more than one transfer. the matching is Luby's: every
+// sampled pair gets a random priority and wins where it has the highest one
+// at both of its organisms, which every pair can check on its own in parallel
+class ConjugationPlanner {
+public:
+    ConjugationPlanner(int columns, int rows, float cell_width, float cell_height);
+
+    void Clear();
+    // returns the slot of the organism, slots count up from 0 in the order of Add
+    int Add(uint64_t entity, const SDL_FRect& rect, int plasmid_count);
+    // every draw depends only on the tick and the entity ids of a pair, so
+    // the plan is the same for any number of threads. the candidate pairs
+    // live in the tick arenas
+    void Plan(WorkerPool& workers, TickArenas& arenas, const CounterRng& rng, uint64_t tick, std::vector<PlasmidTransfer>& out);
+
+    uint64_t Entity(int slot) const { return entities[slot]; }
+    // sampled pairs of the last Plan, before matching
+    size_t SampledCount() const { return sampled; }
+
+private:
+    struct Pair {
+        int donor;
+        int recipient;
+        uint32_t choice;
+        uint64_t priority;
+    };
+
+    SpatialGrid grid;
+    std::vector<uint64_t> entities;
+    std::vector<int> plasmids;
+    // highest priority of a live pair at every slot in the current round
+    std::unique_ptr<std::atomic<uint64_t>[]> best;
+    size_t best_capacity = 0;
+    size_t sampled = 0;
+};
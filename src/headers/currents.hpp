@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include "workers.hpp"
+
+// diffusion kernel for the interior of one row:
+// out[i] = (row[i - 1] + row[i + 1] + up[i] + down[i]) / 4 for i in [1, width - 1)
+typedef void (*DiffuseRowKernel)(const float* up, const float* row, const float* down, float* out, int width);
+
+// picks the widest kernel the running cpu supports (AVX2, SSE2 or scalar)
+DiffuseRowKernel SelectDiffuseKernel();
+const char* DiffuseKernelName();
+
+// fluid currents stored as separate x/y float planes, double buffered so a
+// diffusion step only ever reads the previous step's values
+struct CurrentField {
+    int width;
+    int height;
+
+    CurrentField() : CurrentField(0, 0) {}
+    CurrentField(int w, int h);
+
+    size_t size() const { return x[front].size(); }
+
+    float* X() { return x[front].data(); }
+    float* Y() { return y[front].data(); }
+    const float* X() const { return x[front].data(); }
+    const float* Y() const { return y[front].data(); }
+
+    // one full diffusion step, the result becomes the front buffer
+    void Diffuse();
+    // same step split into row bands across the pool, every band reads its
+    // halo rows from the shared front buffer so the result matches Diffuse()
+    void Diffuse(WorkerPool& workers);
+    // diffuses rows [row_begin, row_end) from the front into the back buffer,
+    // rows may be processed in any order, call Swap() once every row is done
+    void DiffuseRows(int row_begin, int row_end);
+    void Swap() { front ^= 1; }
+
+private:
+    int front;
+    std::vector<float> x[2];
+    std::vector<float> y[2];
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "genome.hpp"
+#include "regulation.hpp"
+#include "protein.hpp"
+#include "alignment.hpp"
+#include "arena.hpp"
+
+// bases upstream of a gene whose regulatory sites still control it
+const size_t EXPRESSION_UPSTREAM = 64;
+// expression level of a gene without any promoter site
+const float EXPRESSION_BASAL = 0.1f;
+
+struct ExpressedGene {
+    int fragment;
+    size_t start;           // coding range [start, end) on the fragment
+    size_t end;
+    // basal plus the promoter site weights (at most 1), scaled by 1 - weight
+    // for every inhibitor site
+    float level;
+    ProteinProfile profile;
+    std::vector<AlignmentHit> hits;
+    // bumped whenever the gene is recomputed, trait hits matched for an older
+    // revision are stale
+    uint32_t revision;
+
+    // the gene depends on the sites starting in [DependencyStart, end) and on
+    // the bases of [start, end), an edit anywhere else leaves it alone
+    size_t DependencyStart() const { return start > EXPRESSION_UPSTREAM ? start - EXPRESSION_UPSTREAM : 0; }
+};
+
+// removed bases at position of one fragment replaced by inserted. position
+// may be the fragment size, which appends to it
+struct Mutation {
+    int fragment;
+    size_t position;
+    size_t removed;
+    std::string inserted;
+};
+
+struct Expression {
+    std::vector<MotifSite> sites;       // by fragment then position
+    std::vector<ExpressedGene> genes;   // by fragment then start
+    // genes recomputed since their traits were last submitted for matching
+    std::vector<int> unmatched;
+};
+
+// annotates every fragment as one gene and expresses the genome from scratch.
+// the proteins are translated into scratch and dropped once profiled
+Expression Express(const Genome& genome, const MotifScanner& motifs, Arena& scratch);
+// applies the mutation to genome and brings expression up to date. the motif
+// scan is redone only around the edit and only genes whose dependencies
+// overlap it are recomputed and queued in unmatched
+void Mutate(Genome& genome, Expression& expression, const MotifScanner& motifs, const Mutation& mutation, Arena& scratch);
+// appends fragment to genome as one more gene, nothing else is scanned or recomputed
+void AddFragment(Genome& genome, Expression& expression, const MotifScanner& motifs, const GenomeFragment& fragment, Arena& scratch);
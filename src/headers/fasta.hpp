@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stddef.h>
+
+#include "workers.hpp"
+
+// bytes of the file each task scans for record starts in a parallel index
+const size_t FASTA_INDEX_CHUNK = 4 << 20;
+// fewest records a worker parses at once
+const int FASTA_PARSE_RANGE = 1024;
+
+// read only view of a whole file, mmap on posix and a file mapping on windows
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+    std::string_view View() const { return std::string_view(data, size); }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+// one record, every view points into the mapped file
+struct FastaRecordView {
+    std::string_view header; // the line after '>', without the line break
+    std::string_view id;     // first word of the header, like blast
+    std::string_view body;   // sequence lines with their line breaks, trailing blank lines cut
+    bool single_line;
+
+    // the bases without line breaks, that's body itself for a one line
+    // record and a copy in scratch otherwise
+    std::string_view Sequence(std::string& scratch) const;
+};
+
+// fasta file mapped into memory and split into records without copying any
+// of it. records stay valid as long as the FastaFile lives
+class FastaFile {
+public:
+    FastaFile() {}
+    FastaFile(const FastaFile&) = delete;
+    FastaFile& operator=(const FastaFile&) = delete;
+
+    // with workers the scan for records and their parsing are split across
+    // the pool, the records come out in file order either way
+    bool Open(const char* path, WorkerPool* workers = nullptr);
+
+    const std::vector<FastaRecordView>& Records() const { return records; }
+    size_t size() const { return records.size(); }
+
+private:
+    MappedFile file;
+    std::vector<FastaRecordView> records;
+};
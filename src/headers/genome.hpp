@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "sequence.hpp"
+
+// immutable bases shared by reference count. copying a handle never copies
+// the bases, so a genome copied from its parent shares every fragment until
+// one side mutates it and gets a copy of just that fragment
+class SharedSequence {
+public:
+    SharedSequence() : sequence(std::make_shared<PackedSequence>()) {}
+    explicit SharedSequence(PackedSequence bases) : sequence(std::make_shared<PackedSequence>(std::move(bases))) {}
+
+    const PackedSequence& operator*() const { return *sequence; }
+    const PackedSequence* operator->() const { return sequence.get(); }
+
+    // the bases for writing, copied first unless this handle is the only owner
+    PackedSequence& Mutable() {
+        if (sequence.use_count() != 1) {
+            sequence = std::make_shared<PackedSequence>(*sequence);
+        }
+        // the last other owner may have let go on another thread, its reads
+        // have to be done before the bases are written
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *sequence;
+    }
+    bool Shared() const { return sequence.use_count() > 1; }
+
+private:
+    std::shared_ptr<PackedSequence> sequence;
+};
+
+struct GenomeFragment {
+    SharedSequence nucleotides;
+    enum class GenomeFragmentType {
+        PLASMID,
+        CHROMOSOME
+    };
+    GenomeFragmentType type;
+
+};
+
+// copies share all fragments, see SharedSequence
+struct Genome {
+    std::vector<GenomeFragment> fragments;
+};
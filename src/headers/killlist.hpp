@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "flecs.h"
+
+// deaths collected during a tick and destroyed together at the end of it.
+// every flecs stage writes into its own buffers, so systems running on
+// worker threads never share one
+struct KillList {
+    struct FoodClaim {
+        flecs::entity_t food;
+        flecs::entity_t organism;
+        bool operator<(const FoodClaim& other) const {
+            return food != other.food ? food < other.food : organism < other.organism;
+        }
+    };
+
+    explicit KillList(int stages) : claims(stages), deaths(stages) {}
+
+    void Claim(int stage, flecs::entity_t food, flecs::entity_t organism) {
+        claims[stage].push_back(FoodClaim{food, organism});
+    }
+
+    void Kill(int stage, flecs::entity_t e) {
+        deaths[stage].push_back(e);
+    }
+
+    // every claimed food goes to the claimant with the lowest id no matter
+    // which stage saw it first, eat(organism) runs once per eaten food
+    template<typename F>
+    void ResolveClaims(F&& eat) {
+        std::vector<FoodClaim>& all = claims[0];
+        for (size_t stage = 1; stage < claims.size(); stage++) {
+            all.insert(all.end(), claims[stage].begin(), claims[stage].end());
+            claims[stage].clear();
+        }
+        std::sort(all.begin(), all.end());
+        for (size_t i = 0; i < all.size(); i++) {
+            if (i > 0 && all[i].food == all[i - 1].food) {
+                continue;
+            }
+            eat(all[i].organism);
+            deaths[0].push_back(all[i].food);
+        }
+        all.clear();
+    }
+
+    // destroys everything killed this tick inside one deferred batch
+    void Flush(const flecs::world& world);
+
+private:
+    std::vector<std::vector<FoodClaim>> claims;
+    std::vector<std::vector<flecs::entity_t>> deaths;
+};
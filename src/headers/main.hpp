@@ -10,6 +10,7 @@
 #include <variant>
 #include <regex>
 #include <string>
+#include <algorithm>
 
 #include "flecs.h"
 
@@ -24,17 +25,55 @@
 #include "parasail.h"
 
 #include "PerlinNoise.hpp"
+#include "currents.hpp"
+#include "rng.hpp"
+#include "spatial.hpp"
+#include "killlist.hpp"
+#include "render.hpp"
+#include "sequence.hpp"
+#include "translation.hpp"
+#include "protein.hpp"
+#include "alignment.hpp"
+#include "aligncache.hpp"
+#include "traitworker.hpp"
+#include "regulation.hpp"
+#include "genome.hpp"
+#include "expression.hpp"
+#include "conjugation.hpp"
+#include "arena.hpp"
 //#include "SimplexNoise.h"
 
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 720;
 const int MAX_FPS = 60;
 const int MAX_PHYSICS_FPS = 60;
+const Uint64 PHYSICS_STEP_NS = 1000000000 / MAX_PHYSICS_FPS;
+const Uint64 FRAME_NS = 1000000000 / MAX_FPS;
+// physics steps a single loop iteration may run to catch up before time is dropped
+const int MAX_PHYSICS_CATCH_UP = 5;
 
 const int WORLD_WIDTH = 100;
 const int WORLD_HEIGHT = 100;
 const int TILE_WIDTH = 4;
 const int TILE_HEIGHT = 4;
+// extra world space around the view that is still drawn, covers interpolated movement
+const float CULL_MARGIN = 4 * TILE_WIDTH;
+
+const uint64_t SIM_SEED = 0x5EED;
+const char TRAIT_DATABASE_PATH[] = "assets/db.fasta";
+// genes of the first organism
+const char FOUNDER_GENOME_PATH[] = "assets/input.fasta";
+// ticks between submitting a trait batch and handing out its hits, fixed so
+// the hits land on the same tick however fast the worker happens to be
+const uint64_t TRAIT_MATCH_LATENCY = 8;
+// longest insertion or deletion a single mutation makes
+const uint32_t MUTATION_MAX_INDEL = 3;
+// chance per tick that a current cell gets pushed in a random direction
+const float CURRENT_NOISE_CHANCE = 0.01;
+// cells sampled as one independent rng stream, keeps noise identical for any thread count
+const int CURRENT_NOISE_CHUNK = 4096;
+// codons translated by --bench-translate without a count
+const long long BENCH_TRANSLATE_CODONS = 1000000;
 
 struct Vector2 {
     float x,y;
@@ -44,6 +83,10 @@ struct Vector2 {
         return Vector2(x + other.x, y + other.y);
     }
 
+    Vector2 operator-(const Vector2& other) const {
+        return Vector2(x - other.x, y - other.y);
+    }
+
     Vector2 operator+=(const Vector2& other) {
         this->x += other.x;
         this->y += other.y;
@@ -77,6 +120,13 @@ struct Position {
     Position(Vector2 v2) { v = v2; }
 };
 
+// position before the last physics step, rendering blends from it to Position
+struct PreviousPosition {
+    Vector2 v;
+    PreviousPosition() {};
+    PreviousPosition(Vector2 v2) { v = v2; }
+};
+
 struct Velocity {
     Vector2 v;
     Velocity() {};
@@ -122,159 +172,120 @@ struct Sprite {
 struct TileMap {
     int width;
     int height;
-    std::vector<Vector2> currents; // fluid currents in general (water or air)
+    CurrentField currents; // fluid currents in general (water or air)
     std::vector<Terrains> terrains;
+    std::vector<int> dirty_terrain; // tiles changed since the terrain layer last redrew them
     TileMap() : TileMap(WORLD_WIDTH, WORLD_HEIGHT) {}
-    TileMap(int w, int h) : width(w), height(h), currents(w*h), terrains(w*h){
+    TileMap(int w, int h) : width(w), height(h), currents(w, h), terrains(w*h){
         for (int i = 0; i < terrains.size(); i++) {
             terrains[i] = Terrains::WATER;
         }
     }
 
+    Vector2 GetCurrentAt(int i) const {
+        return Vector2(currents.X()[i], currents.Y()[i]);
+    }
+
     Vector2 GetCurrentAt(int x, int y) const {
-        return currents[x + y * width];
+        return GetCurrentAt(x + y * width);
     }
 
     Vector2 GetCurrentAt(Vector2 v) const {
-        return currents[((int)v.x) + ((int)v.y) * width];
+        return GetCurrentAt(((int)v.x) + ((int)v.y) * width);
+    }
+
+    // current at a point in tile units, blended from the four nearest tile
+    // centres. points beyond the outer centres take the edge tiles
+    Vector2 SampleCurrent(Vector2 v) const {
+        float fx = std::min(std::max(v.x - 0.5f, 0.0f), (float)(width - 1));
+        float fy = std::min(std::max(v.y - 0.5f, 0.0f), (float)(height - 1));
+        int x0 = (int)fx;
+        int y0 = (int)fy;
+        int x1 = std::min(x0 + 1, width - 1);
+        int y1 = std::min(y0 + 1, height - 1);
+        float tx = fx - x0;
+        float ty = fy - y0;
+        auto blend = [&](const float* plane) {
+            float top = plane[x0 + y0 * width] * (1 - tx) + plane[x1 + y0 * width] * tx;
+            float bottom = plane[x0 + y1 * width] * (1 - tx) + plane[x1 + y1 * width] * tx;
+            return top * (1 - ty) + bottom * ty;
+        };
+        return Vector2(blend(currents.X()), blend(currents.Y()));
+    }
+
+    void SetTerrain(int i, Terrains t) {
+        terrains[i] = t;
+        dirty_terrain.push_back(i);
+    }
+
+    void SetCurrentAt(int i, Vector2 v) {
+        currents.X()[i] = v.x;
+        currents.Y()[i] = v.y;
     }
 
-    void CreateCurrents() {
+    void CreateCurrents(const CounterRng& rng) {
         for(int i = 0; i < currents.size(); i++) {
             siv::PerlinNoise noise{};
             float angle = noise.noise2D(i % width, i / width) * M_PI * 2;
             //float angle = SimplexNoise::noise(i % width, i / width) * M_PI * 2;
-            float speed = SDL_randf() * 2;
+            float speed = rng.Uniform(RngStream::CURRENT_INIT, 0, i) * 2;
             //float speed = SimplexNoise::noise(1, i % width + (currents.size() + 500), i / width + (currents.size() + 500)) * 2;
-            currents[i] = Vector2(cosf(angle), sinf(angle)) * speed;
-            if (std::isnan(currents[i].x) || std::isnan(currents[i].y)) {
+            SetCurrentAt(i, Vector2(cosf(angle), sinf(angle)) * speed);
+            if (std::isnan(currents.X()[i]) || std::isnan(currents.Y()[i])) {
                 printf("nan: invalid angle? %f invalid speed? %f\n", angle, speed);
             }
         
         }
     }
 
-    void UpdateCurrents() {
-        for (int x, y = 0; x + y * width < currents.size(); x++) {
-            if (x == width) {
-                x = 0;
-                y++;
-            }
-            Vector2 average(0,0);
-            int neighbors = 0;
-            if (x > 0) {
-                average += GetCurrentAt(x - 1, y);
-                neighbors++;
-                if (x + 1 < width) {
-                    average += GetCurrentAt(x + 1, y);
-                }   
-            }
-            if (y > 0) {
-                average += GetCurrentAt(x, y - 1);
-                neighbors++;
-                if (y + 1 < height) {
-                    average += GetCurrentAt(x, y + 1);
-                }   
-            }
-            currents[x + y * width] = average / neighbors;
-            if (currents[x + y * width].x >  2 || currents[x + y * width].y > 2) {
-                printf("average: (%f,%f), neighbors: %d", average.x, average.y, neighbors);
-            }
-        }
+    // each cell becomes the average of its neighbours from the previous step
+    void UpdateCurrents(WorkerPool& workers) {
+        currents.Diffuse(workers);
     }
 
-    void ApplyNoise(){
-	    for (int i = 0; i < currents.size(); i++) {
-            if (SDL_randf() < 0.01) {
-                float angle = SDL_randf() * M_PI * 2;
-	    		float speed = SDL_randf() * 0.2 + 0.1;
-                currents[i] += Vector2(cosf(angle), sinf(angle)) * speed;
+    void ApplyNoise(WorkerPool& workers, const CounterRng& rng, uint64_t tick) {
+        int chunks = (currents.size() + CURRENT_NOISE_CHUNK - 1) / CURRENT_NOISE_CHUNK;
+        workers.ParallelFor(chunks, 1, [&](int first_chunk, int last_chunk, int) {
+            for (int chunk = first_chunk; chunk < last_chunk; chunk++) {
+                int begin = chunk * CURRENT_NOISE_CHUNK;
+                int end = std::min(begin + CURRENT_NOISE_CHUNK, (int)currents.size());
+                SampleBernoulli(rng, RngStream::CURRENT_NOISE, tick, (uint64_t)chunk << 32, begin, end, CURRENT_NOISE_CHANCE, [&](int i, const RngBlock& r) {
+                    float angle = UniformFloat(r.w[1]) * M_PI * 2;
+                    float speed = UniformFloat(r.w[2]) * 0.2 + 0.1;
+                    SetCurrentAt(i, GetCurrentAt(i) + Vector2(cosf(angle), sinf(angle)) * speed);
+                });
             }
-        }
+        });
     }
 };
 
-const std::unordered_map<std::string, char> CODON_TABLE = {
-    {"GCT", 'A'}, {"GCC", 'A'}, {"GCA", 'A'}, {"GCG", 'A'}, // Ala
-    {"GGT", 'R'}, {"GGC", 'R'}, {"GGA", 'R'}, {"GGG", 'R'}, // Arg
-    {"AAT", 'N'}, {"AAC", 'N'}, // Asn
-    {"GAT", 'D'}, {"GAC", 'D'}, // Asp
-    {"TGT", 'C'}, {"TGC", 'C'}, // Cys
-    {"CAA", 'Q'}, {"CAG", 'Q'}, // Gln
-    {"GAA", 'E'}, {"GAG", 'E'}, // Glu
-    {"GGT", 'G'}, {"GGC", 'G'}, {"GGA", 'G'}, {"GGG", 'G'}, // Gly
-    {"CAT", 'H'}, {"CAC", 'H'}, // His
-    {"ATT", 'I'}, {"ATC", 'I'}, {"ATA", 'I'}, // Ile
-    {"TTA", 'L'}, {"TTG", 'L'}, {"CTT", 'L'}, {"CTC", 'L'}, {"CTA", 'L'}, {"CTG", 'L'}, // Leu
-    {"AAA", 'K'}, {"AAG", 'K'}, // Lys
-    {"ATG", 'M'}, // Met (start codon)
-    {"TTT", 'F'}, {"TTC", 'F'}, // Phe
-    {"CCT", 'P'}, {"CCC", 'P'}, {"CCA", 'P'}, {"CCG", 'P'}, // Pro
-    {"TCT", 'S'}, {"TCC", 'S'}, {"TCA", 'S'}, {"TCG", 'S'}, {"AGT", 'S'}, {"AGC", 'S'}, // Ser
-    {"ACT", 'T'}, {"ACC", 'T'}, {"ACA", 'T'}, {"ACG", 'T'}, // Thr
-    {"TGG", 'W'}, // Trp
-    {"TAT", 'Y'}, {"TAC", 'Y'}, // Tyr
-    {"GTT", 'V'}, {"GTC", 'V'}, {"GTA", 'V'}, {"GTG", 'V'}, // Val
-    {"TAA", '*'}, {"TAG", '*'}, {"TGA", '*'} // Stop codons
-};
-
-const std::unordered_map<char, std::array<double, 4>> AMINO_ACID_PROPERTIES = {
-    {'A', {0.62, 0.0, 0.0, 0.31}},  // Alanine: hydrophobic, neutral, nonpolar, small
-    {'R', {-2.53, 1.0, 1.0, 0.98}}, // Arginine: hydrophilic, positive, polar, large
-    {'N', {-0.78, 0.0, 1.0, 0.58}}, // Asparagine: hydrophilic, neutral, polar, medium
-    {'D', {-0.90, -1.0, 1.0, 0.54}}, // Aspartic acid: hydrophilic, negative, polar, medium
-    {'C', {0.29, 0.0, 0.0, 0.46}},  // Cysteine: slightly hydrophobic, neutral, nonpolar, small
-    {'Q', {-0.85, 0.0, 1.0, 0.68}}, // Glutamine: hydrophilic, neutral, polar, medium
-    {'E', {-0.74, -1.0, 1.0, 0.68}}, // Glutamic acid: hydrophilic, negative, polar, medium
-    {'G', {0.48, 0.0, 0.0, 0.0}},   // Glycine: neutral, neutral, nonpolar, smallest
-    {'H', {-0.40, 0.5, 1.0, 0.78}}, // Histidine: hydrophilic, partially positive, polar, large
-    {'I', {1.38, 0.0, 0.0, 0.73}},  // Isoleucine: hydrophobic, neutral, nonpolar, large
-    {'L', {1.06, 0.0, 0.0, 0.73}},  // Leucine: hydrophobic, neutral, nonpolar, large
-    {'K', {-1.50, 1.0, 1.0, 0.85}}, // Lysine: hydrophilic, positive, polar, large
-    {'M', {0.64, 0.0, 0.0, 0.78}},  // Methionine: hydrophobic, neutral, nonpolar, large
-    {'F', {1.19, 0.0, 0.0, 0.85}},  // Phenylalanine: hydrophobic, neutral, nonpolar, large
-    {'P', {0.12, 0.0, 0.0, 0.51}},  // Proline: neutral, neutral, nonpolar, medium
-    {'S', {-0.18, 0.0, 1.0, 0.38}}, // Serine: hydrophilic, neutral, polar, small
-    {'T', {-0.05, 0.0, 1.0, 0.46}}, // Threonine: hydrophilic, neutral, polar, small
-    {'W', {0.81, 0.0, 0.0, 1.0}},   // Tryptophan: hydrophobic, neutral, nonpolar, largest
-    {'Y', {0.26, 0.0, 1.0, 0.85}},  // Tyrosine: hydrophobic, neutral, polar, large
-    {'V', {1.08, 0.0, 0.0, 0.61}},  // Valine: hydrophobic, neutral, nonpolar, medium
-    {'X', {0.0, 0.0, 0.0, 0.5}}     // Unknown: neutral values
-};
-
-// Regulatory elements
-struct Promoter {
-    std::string sequence;
-    double strength;        // 0.0 - 1.0, how strongly it promotes transcription
-    double specificity;     // 0.0 - 1.0, how specific the binding is
-    
-    Promoter(const std::string& seq, double str = 0.5, double spec = 0.5) 
-        : sequence(seq), strength(str), specificity(spec) {}
+// trait hits of every gene of the genome
+struct TraitHits {
+    std::vector<AlignmentHit> hits;
 };
-
-struct Inhibitor {
-    std::string sequence;
-    double inhibition_strength;  // 0.0 - 1.0, how much it reduces expression
-    double binding_affinity;     // 0.0 - 1.0, how likely to bind
-    
-    Inhibitor(const std::string& seq, double inh = 0.5, double aff = 0.5)
-        : sequence(seq), inhibition_strength(inh), binding_affinity(aff) {}
-};
-
-struct GenomeFragment {
-    std::string nucleotides;
-    enum class GenomeFragmentType {
-        PLASMID,
-        CHROMOSOME
-    };
-    GenomeFragmentType type;
-
-};
-
-struct Genome {
-    std::vector<GenomeFragment> fragments;
+// the genome was replaced as a whole and has to be expressed from scratch
+struct GenomeChanged {};
+// genes of the expression were recomputed and their traits have to be matched again
+struct TraitsPending {};
+
+Genome LoadGenome(const char* path, WorkerPool& workers);
+
+struct SimOptions {
+    bool headless = false;
+    long long ticks = 0;
+    bool until_extinct = false;
+    uint64_t seed = SIM_SEED;
+    int threads = WorkerPool::DefaultThreadCount();
+    std::string match_path;
+    float mutation_rate = 0;
+    long long bench_translate = 0;  // codons, 0 runs the simulation
 };
 
-void init();
+bool ParseOptions(int argc, char** argv, SimOptions& options);
+void PrintUsage(const char* program);
+int RunHeadless(flecs::world& world, TickArenas& arenas, const SimOptions& options);
+int RunMatch(const TraitMatcher& matcher, const char* path, WorkerPool& workers);
+int RunTranslateBench(const SimOptions& options);
+void init(const SimOptions& options);
 int cleanup(SDL_Window* window, SDL_Renderer* renderer, ImGuiContext* ctx);
 SDL_FRect ReadAtlas(Sprite s);
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string_view>
+
+struct AminoAcidProperties {
+    char residue;
+    float hydrophobicity;
+    float charge;
+    float polarity;
+    float size;
+};
+
+constexpr AminoAcidProperties AMINO_ACID_PROPERTIES[] = {
+    {'A', 0.62f, 0.0f, 0.0f, 0.31f},  // Alanine: hydrophobic, neutral, nonpolar, small
+    {'R', -2.53f, 1.0f, 1.0f, 0.98f}, // Arginine: hydrophilic, positive, polar, large
+    {'N', -0.78f, 0.0f, 1.0f, 0.58f}, // Asparagine: hydrophilic, neutral, polar, medium
+    {'D', -0.90f, -1.0f, 1.0f, 0.54f}, // Aspartic acid: hydrophilic, negative, polar, medium
+    {'C', 0.29f, 0.0f, 0.0f, 0.46f},  // Cysteine: slightly hydrophobic, neutral, nonpolar, small
+    {'Q', -0.85f, 0.0f, 1.0f, 0.68f}, // Glutamine: hydrophilic, neutral, polar, medium
+    {'E', -0.74f, -1.0f, 1.0f, 0.68f}, // Glutamic acid: hydrophilic, negative, polar, medium
+    {'G', 0.48f, 0.0f, 0.0f, 0.0f},   // Glycine: neutral, neutral, nonpolar, smallest
+    {'H', -0.40f, 0.5f, 1.0f, 0.78f}, // Histidine: hydrophilic, partially positive, polar, large
+    {'I', 1.38f, 0.0f, 0.0f, 0.73f},  // Isoleucine: hydrophobic, neutral, nonpolar, large
+    {'L', 1.06f, 0.0f, 0.0f, 0.73f},  // Leucine: hydrophobic, neutral, nonpolar, large
+    {'K', -1.50f, 1.0f, 1.0f, 0.85f}, // Lysine: hydrophilic, positive, polar, large
+    {'M', 0.64f, 0.0f, 0.0f, 0.78f},  // Methionine: hydrophobic, neutral, nonpolar, large
+    {'F', 1.19f, 0.0f, 0.0f, 0.85f},  // Phenylalanine: hydrophobic, neutral, nonpolar, large
+    {'P', 0.12f, 0.0f, 0.0f, 0.51f},  // Proline: neutral, neutral, nonpolar, medium
+    {'S', -0.18f, 0.0f, 1.0f, 0.38f}, // Serine: hydrophilic, neutral, polar, small
+    {'T', -0.05f, 0.0f, 1.0f, 0.46f}, // Threonine: hydrophilic, neutral, polar, small
+    {'W', 0.81f, 0.0f, 0.0f, 1.0f},   // Tryptophan: hydrophobic, neutral, nonpolar, largest
+    {'Y', 0.26f, 0.0f, 1.0f, 0.85f},  // Tyrosine: hydrophobic, neutral, polar, large
+    {'V', 1.08f, 0.0f, 0.0f, 0.61f},  // Valine: hydrophobic, neutral, nonpolar, medium
+    {'X', 0.0f, 0.0f, 0.0f, 0.5f}     // Unknown: neutral values
+};
+
+enum class AminoAcidProperty {
+    HYDROPHOBICITY,
+    CHARGE,
+    POLARITY,
+    SIZE,
+    PROPERTY_COUNT
+};
+
+const int PROPERTY_COUNT = (int)AminoAcidProperty::PROPERTY_COUNT;
+
+// one 256 entry column per property indexed by the residue letter, anything
+// not listed above (stops included) gets the values of 'X'
+struct PropertyTables {
+    std::array<std::array<float, 256>, PROPERTY_COUNT> columns;
+};
+
+constexpr PropertyTables MakePropertyTables() {
+    PropertyTables tables{};
+    const AminoAcidProperties* unknown = nullptr;
+    for (const AminoAcidProperties& entry : AMINO_ACID_PROPERTIES) {
+        if (entry.residue == 'X') {
+            unknown = &entry;
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        const AminoAcidProperties* match = unknown;
+        for (const AminoAcidProperties& entry : AMINO_ACID_PROPERTIES) {
+            if ((unsigned char)entry.residue == c) {
+                match = &entry;
+            }
+        }
+        tables.columns[0][c] = match->hydrophobicity;
+        tables.columns[1][c] = match->charge;
+        tables.columns[2][c] = match->polarity;
+        tables.columns[3][c] = match->size;
+    }
+    return tables;
+}
+
+constexpr PropertyTables PROPERTY_TABLES = MakePropertyTables();
+
+// residues per sliding window, the usual width of a hydropathy plot
+const int PROFILE_WINDOW = 9;
+
+// compact phenotype summary of one protein
+struct ProteinProfile {
+    int length;
+    float mean_hydrophobicity;
+    float net_charge;
+    float mean_polarity;
+    float mean_size;
+    // extremes of the sliding window averages, a very hydrophobic window
+    // hints at a membrane spanning segment
+    float max_window_hydrophobicity;
+    float min_window_hydrophobicity;
+    float max_window_charge;
+    float min_window_charge;
+};
+
+// protein is a translated sequence, normally one open reading frame without
+// its stop. every path sums in the same order so results match on any cpu
+ProteinProfile ComputeProfile(std::string_view protein, int window = PROFILE_WINDOW);
+
+// average of the property over every window of the protein, out is
+// overwritten and keeps its capacity
+void SlidingWindowAverage(std::string_view protein, AminoAcidProperty property, int window, std::vector<float>& out);
+
+const char* ProfileKernelName();
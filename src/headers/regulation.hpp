@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sequence.hpp"
+#include "arena.hpp"
+
+// Regulatory elements
+struct Promoter {
+    std::string sequence;
+    double strength;        // 0.0 - 1.0, how strongly it promotes transcription
+    double specificity;     // 0.0 - 1.0, how specific the binding is
+
+    Promoter(const std::string& seq, double str = 0.5, double spec = 0.5)
+        : sequence(seq), strength(str), specificity(spec) {}
+};
+
+struct Inhibitor {
+    std::string sequence;
+    double inhibition_strength;  // 0.0 - 1.0, how much it reduces expression
+    double binding_affinity;     // 0.0 - 1.0, how likely to bind
+
+    Inhibitor(const std::string& seq, double inh = 0.5, double aff = 0.5)
+        : sequence(seq), inhibition_strength(inh), binding_affinity(aff) {}
+};
+
+// most mismatches a site may have
+const int MOTIF_MAX_MISMATCHES = 2;
+// a motif allows one mismatch per this many bases. a 6 base motif with two
+// would turn up by chance every few dozen bases
+const int MOTIF_BASES_PER_MISMATCH = 6;
+// shortest exact piece a motif is split into, shorter pieces would hit
+// nearly everywhere in the genome. motifs too short to give k + 1 pieces of
+// this length are matched bit parallel instead
+const int MOTIF_MIN_PIECE = 4;
+// longest motif the bit parallel matcher takes, one bit per base of a word
+const int MOTIF_SHIFT_LENGTH = 64;
+
+enum class MotifKind {
+    PROMOTER,
+    INHIBITOR
+};
+
+struct MotifSite {
+    MotifKind kind;
+    int motif;          // index into the promoters or inhibitors
+    int fragment;
+    size_t position;    // first base of the site on the forward strand
+    bool minus;         // the motif reads on the reverse complement
+    int mismatches;
+    // strength (or inhibition_strength * binding_affinity) scaled down for
+    // every mismatch: by 1 - specificity for promoters and by
+    // binding_affinity for inhibitors, so a very specific promoter only
+    // counts where it matches exactly
+    float weight;
+};
+
+// finds every promoter and inhibitor site in a sequence in one pass. every
+// motif on both strands is split into k + 1 pieces, one of which has to
+// match exactly wherever the motif matches with at most k mismatches
+// (pigeonhole). all pieces go into one aho-corasick automaton over the 2
+// bit base codes, so the scan costs one table step per base however many
+// motifs there are, and only piece hits are checked with a packed compare.
+// motifs too short for k + 1 pieces, like the 6 base promoter boxes, are
+// packed side by side into 64 bit words and run through a k mismatch
+// shift-and in the same pass, k + 1 shifts per word and base
+class MotifScanner {
+public:
+    MotifScanner(const std::vector<Promoter>& promoters, const std::vector<Inhibitor>& inhibitors, int max_mismatches = MOTIF_MAX_MISMATCHES);
+
+    // appends the sites in sequence sorted by position, fragment is copied
+    // into each. the shift-and state lives in scratch
+    void Scan(const PackedSequence& sequence, int fragment, std::vector<MotifSite>& out, Arena& scratch) const {
+        Scan(sequence, fragment, 0, sequence.size(), out, scratch);
+    }
+    // only the sites lying entirely inside [begin, end)
+    void Scan(const PackedSequence& sequence, int fragment, size_t begin, size_t end, std::vector<MotifSite>& out, Arena& scratch) const;
+
+    // longest motif, an edit can only create or destroy sites starting less than this many bases before it
+    int MaxLength() const { return max_length; }
+    // expected summed weight of the sites of one kind that turn up by chance
+    // in length uniformly random bases, on both strands
+    double ChanceWeight(MotifKind kind, size_t length) const;
+    size_t StateCount() const { return next.size(); }
+
+private:
+    // one motif on one strand, bases packed like PackedSequence::Extract in
+    // chunks of 32 with the first base highest
+    struct Pattern {
+        MotifKind kind;
+        int motif;
+        bool minus;
+        int length;
+        int max_mismatches;
+        float weight;
+        float mismatch_factor;
+        std::vector<uint64_t> bases;
+        // 01 in every 2 bit group whose motif letter isn't ACGT, it never matches
+        std::vector<uint64_t> unknown;
+    };
+    struct Piece {
+        int pattern;
+        int offset;
+        int length;
+    };
+    // short patterns sharing one word, pattern i owns the bits from its
+    // first base at starts up to its last base at finals
+    struct ShiftGroup {
+        // bits whose pattern letter is the base code, an N matches nothing
+        std::array<uint64_t, 5> masks;
+        uint64_t starts;
+        uint64_t finals;
+        int used;           // bits
+        int max_mismatches;
+        std::array<int, MOTIF_SHIFT_LENGTH> final_pattern;  // by bit of finals
+    };
+
+    void AddPattern(Pattern pattern, const std::string& sequence);
+    void AddShiftPattern(int index, const std::vector<int>& codes);
+    void Build();
+    int Mismatches(const PackedSequence& sequence, const Pattern& pattern, size_t start) const;
+
+    std::vector<Pattern> patterns;
+    std::vector<Piece> pieces;
+    // dense automaton, next[state][code] already follows the failure links
+    std::vector<std::array<int, 4>> next;
+    std::vector<int> fail;
+    // pieces ending in a state and the nearest state down the failure chain with pieces of its own
+    std::vector<std::vector<int>> state_pieces;
+    std::vector<int> output_link;
+    std::vector<ShiftGroup> shift_groups;
+    int shift_mismatches = 0;   // most of any shift group
+    int max_length = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include "SDL3/SDL.h"
+
+#include "spatial.hpp"
+
+// below this zoom entities are drawn as a density heatmap instead of one rect each
+const float LOD_ZOOM = 0.5f;
+// tiles per side of one heatmap cell
+const int HEATMAP_CELL_TILES = 8;
+
+// maps world space to the window, x and y are the world position shown at
+// the top left corner of the window
+struct Camera {
+    float x = 0;
+    float y = 0;
+    float zoom = 1;
+
+    SDL_FRect ToScreen(const SDL_FRect& world) const {
+        return SDL_FRect{(world.x - x) * zoom, (world.y - y) * zoom, world.w * zoom, world.h * zoom};
+    }
+    // the part of the world that lands inside a screen of the given size
+    SDL_FRect Visible(int screen_width, int screen_height) const {
+        return SDL_FRect{x, y, screen_width / zoom, screen_height / zoom};
+    }
+    void Pan(float screen_dx, float screen_dy) {
+        x -= screen_dx / zoom;
+        y -= screen_dy / zoom;
+    }
+    // zooms while keeping the world point under the screen position in place
+    void ZoomAt(float factor, float screen_x, float screen_y);
+};
+
+// solid colored rects gathered over a frame and drawn with one
+// SDL_RenderGeometry call instead of one SDL_RenderFillRect each
+struct RectBatch {
+    void Add(const SDL_FRect& rect, SDL_FColor color);
+    void Add(const SDL_FRect& rect, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+        Add(rect, SDL_FColor{r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f});
+    }
+    // draws every rect added since the last submit and empties the batch,
+    // the buffers keep their capacity for the next frame
+    void Submit(SDL_Renderer* renderer);
+
+    size_t size() const { return vertices.size() / 4; }
+
+private:
+    std::vector<SDL_Vertex> vertices;
+    // two triangles per rect, only ever grows since the pattern never changes
+    std::vector<int> indices;
+};
+
+// tiles per side of one terrain chunk texture
+const int TERRAIN_CHUNK_TILES = 64;
+
+// static terrain drawn once into render target textures, one per chunk of
+// tiles, so a frame only blits the chunks. tiles are only redrawn once marked
+// dirty, after the renderer lost its targets every tile is
+struct TerrainLayer {
+    TerrainLayer(int width, int height, int tile_width, int tile_height);
+    ~TerrainLayer();
+    TerrainLayer(const TerrainLayer&) = delete;
+    TerrainLayer& operator=(const TerrainLayer&) = delete;
+
+    void MarkDirty(int tile);
+    void MarkAllDirty();
+    // frees the chunk textures, has to run before their renderer is destroyed.
+    // after a device reset too, the next Update creates fresh ones
+    void Release();
+
+    // redraws every dirty tile into its chunk, tile_source(tile) gives the
+    // tileset rect of a tile index
+    template<typename F>
+    void Update(SDL_Renderer* renderer, SDL_Texture* tileset, F&& tile_source) {
+        SDL_Texture* previous_target = nullptr;
+        bool switched = false;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            Chunk& chunk = chunks[c];
+            if (!chunk.all_dirty && chunk.dirty.empty()) {
+                continue;
+            }
+            if (chunk.texture == nullptr && !CreateChunkTexture(renderer, c)) {
+                continue;
+            }
+            if (!switched) {
+                previous_target = SDL_GetRenderTarget(renderer);
+                switched = true;
+            }
+            SDL_SetRenderTarget(renderer, chunk.texture);
+            if (chunk.all_dirty) {
+                chunk.dirty.clear();
+                for (int y = chunk.y; y < chunk.y + chunk.rows; y++) {
+                    for (int x = chunk.x; x < chunk.x + chunk.columns; x++) {
+                        chunk.dirty.push_back(x + y * width);
+                    }
+                }
+            }
+            for (int tile : chunk.dirty) {
+                SDL_FRect src = tile_source(tile);
+                SDL_FRect dst{(float)(tile % width - chunk.x) * tile_width, (float)(tile / width - chunk.y) * tile_height, (float)tile_width, (float)tile_height};
+                SDL_RenderTexture(renderer, tileset, &src, &dst);
+            }
+            chunk.dirty.clear();
+            chunk.all_dirty = false;
+        }
+        if (switched) {
+            SDL_SetRenderTarget(renderer, previous_target);
+        }
+    }
+
+    // blits the chunks overlapping visible (in world space)
+    void Draw(SDL_Renderer* renderer, const Camera& camera, const SDL_FRect& visible) const;
+
+private:
+    struct Chunk {
+        int x, y;          // first tile
+        int columns, rows; // in tiles, smaller at the right and bottom edges
+        SDL_Texture* texture;
+        bool all_dirty;
+        std::vector<int> dirty;
+    };
+
+    bool CreateChunkTexture(SDL_Renderer* renderer, size_t c);
+    size_t ChunkOf(int tile) const;
+
+    int width;
+    int height;
+    int tile_width;
+    int tile_height;
+    int chunk_columns;
+    std::vector<Chunk> chunks;
+};
+
+// shades every heatmap cell overlapping visible by how many grid entries
+// start inside it, reads only the grid's cell counts and not the entries
+void DrawDensity(RectBatch& batch, const SpatialGrid& grid, const Camera& camera, const SDL_FRect& visible);
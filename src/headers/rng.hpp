@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// independent random streams, each system draws from its own so adding draws
+// to one never shifts the numbers another one sees
+enum class RngStream : uint32_t {
+    CURRENT_INIT,
+    CURRENT_NOISE,
+    FOOD_SPAWN,
+    MUTATION,
+    CONJUGATION,
+    BENCHMARK,
+};
+
+struct RngBlock {
+    uint32_t w[4];
+};
+
+// maps 32 random bits to a float in [0, 1)
+inline float UniformFloat(uint32_t bits) {
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// stateless Philox4x32-10 generator, every block is a pure function of
+// (seed, stream, tick, index) so draws can happen in any order on any thread
+struct CounterRng {
+    uint64_t seed;
+
+    CounterRng() : CounterRng(0) {}
+    explicit CounterRng(uint64_t s) : seed(s) {}
+
+    RngBlock Block(RngStream stream, uint64_t tick, uint64_t index) const;
+    float Uniform(RngStream stream, uint64_t tick, uint64_t index) const {
+        return UniformFloat(Block(stream, tick, index).w[0]);
+    }
+
+    // blocks for indices [first, first + count), block j is written to out[4 * j .. 4 * j + 3]
+    void FillBlocks(RngStream stream, uint64_t tick, uint64_t first, uint32_t* out, size_t count) const;
+    // 4 * count uniform floats from the same blocks FillBlocks would produce
+    void FillUniform(RngStream stream, uint64_t tick, uint64_t first, float* out, size_t count) const;
+};
+
+// visits every index of [begin, end) independently with probability p, like
+// testing each one against a uniform draw, but jumps straight from one hit to
+// the next with geometric skips so only about p * (end - begin) blocks are drawn.
+// draws use indices counter_base, counter_base + 1, ... and visit gets the
+// block that selected the index, words 1 to 3 are free for the caller
+template<typename F>
+void SampleBernoulli(const CounterRng& rng, RngStream stream, uint64_t tick, uint64_t counter_base, int begin, int end, float p, F&& visit) {
+    if (p <= 0) {
+        return;
+    }
+    float log_miss = p < 1 ? logf(1 - p) : 0;
+    uint64_t draw = counter_base;
+    for (int i = begin; i < end; i++) {
+        RngBlock block = rng.Block(stream, tick, draw++);
+        if (log_miss < 0) {
+            // (0, 1] so the log stays finite
+            float u = ((block.w[0] >> 8) + 1) * (1.0f / 16777216.0f);
+            float skip = floorf(logf(u) / log_miss);
+            if (skip >= end - i) {
+                return;
+            }
+            i += (int)skip;
+        }
+        visit(i, block);
+    }
+}
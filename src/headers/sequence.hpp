@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <stddef.h>
+
+// 2 bit base codes, complementing a base is code ^ 3
+const uint8_t BASE_A = 0;
+const uint8_t BASE_C = 1;
+const uint8_t BASE_G = 2;
+const uint8_t BASE_T = 3;
+const char BASE_LETTERS[] = "ACGT";
+const size_t BASES_PER_WORD = 32;
+
+// returns false for anything that isn't A, C, G or T (either case)
+inline bool EncodeBase(char c, uint8_t& code) {
+    switch (c) {
+        case 'A': case 'a': code = BASE_A; return true;
+        case 'C': case 'c': code = BASE_C; return true;
+        case 'G': case 'g': code = BASE_G; return true;
+        case 'T': case 't': code = BASE_T; return true;
+    }
+    code = BASE_A;
+    return false;
+}
+
+// reverse complement of a nucleotide string, anything but ACGT becomes N
+void ReverseComplement(std::string_view bases, std::string& out);
+// the same into out, which needs room for bases.size() letters
+void ReverseComplement(std::string_view bases, char* out);
+
+// nucleotides packed 2 bits per base, 32 to a word with base 0 in the lowest
+// bits. anything other than ACGT is kept as an N in a side bitmap (stored as
+// A in the packed words), which stays empty for clean sequences
+struct PackedSequence {
+    PackedSequence() : length(0), ambiguous_count(0) {}
+    explicit PackedSequence(std::string_view bases);
+
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    uint8_t Code(size_t i) const {
+        return (words[i / BASES_PER_WORD] >> (2 * (i % BASES_PER_WORD))) & 3;
+    }
+    bool IsAmbiguous(size_t i) const {
+        return ambiguous_count > 0 && i / 64 < ambiguous.size() && (ambiguous[i / 64] >> (i % 64)) & 1;
+    }
+    bool HasAmbiguous() const { return ambiguous_count > 0; }
+    char At(size_t i) const {
+        return IsAmbiguous(i) ? 'N' : BASE_LETTERS[Code(i)];
+    }
+
+    // up to 32 bases starting at pos, the first base in the most significant
+    // position, so three bases give the codon index 16 * b0 + 4 * b1 + b2
+    uint64_t Extract(size_t pos, int count) const;
+    // true if any base in [pos, pos + count) is ambiguous
+    bool AnyAmbiguous(size_t pos, size_t count) const;
+
+    const std::vector<uint64_t>& Words() const { return words; }
+
+    void Append(char base);
+    void Append(std::string_view bases);
+
+    PackedSequence Substr(size_t pos, size_t count) const;
+    PackedSequence ReverseComplement() const;
+    std::string ToString() const;
+    // writes the size() bases as letters into out
+    void Unpack(char* out) const;
+
+    // mutations, all positions are base indices. Insert and Erase clamp pos
+    // to size() like Substr, so inserting past the end appends
+    void Substitute(size_t pos, char base);
+    void Insert(size_t pos, std::string_view bases);
+    void Erase(size_t pos, size_t count);
+
+    // 64 bit hash of the bases and the ambiguity flags, equal sequences hash equal
+    uint64_t Hash() const;
+
+    bool operator==(const PackedSequence& other) const;
+    bool operator!=(const PackedSequence& other) const { return !(*this == other); }
+
+private:
+    void SetCode(size_t i, uint8_t code);
+    void SetAmbiguous(size_t i, bool value);
+    // copies count bases starting at pos of this sequence onto the end of out
+    void AppendRange(PackedSequence& out, size_t pos, size_t count) const;
+
+    size_t length;
+    size_t ambiguous_count;
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> ambiguous; // one bit per base, only allocated once needed
+};
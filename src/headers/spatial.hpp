@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+#include "SDL3/SDL.h"
+
+// uniform grid over the world, rebuilt every tick with a counting sort so the
+// entries of one cell are contiguous. an entry is stored once, in the cell of
+// its top left corner, and queries widen their search by the largest entry
+struct SpatialGrid {
+    struct Entry {
+        uint64_t id;
+        SDL_FRect rect;
+    };
+
+    int columns;
+    int rows;
+    float cell_width;
+    float cell_height;
+
+    SpatialGrid(int columns, int rows, float cell_width, float cell_height);
+
+    // drops every entry, the buffers keep their capacity for the next rebuild
+    void Clear();
+    // staged until the next Build
+    void Insert(uint64_t id, const SDL_FRect& rect);
+    void Build();
+
+    size_t size() const { return entries.size(); }
+    // entries after Build, ordered by cell so neighbours are close in memory
+    const Entry& operator[](size_t i) const { return entries[i]; }
+    // entries whose top left corner lies in the cell, no entry is visited
+    int CellCount(int column, int row) const {
+        if (entries.empty()) {
+            return 0;
+        }
+        int cell = column + row * columns;
+        return cell_start[cell + 1] - cell_start[cell];
+    }
+
+    // calls visit(const Entry&) once for every entry whose rect intersects area
+    template<typename F>
+    void Query(const SDL_FRect& area, F&& visit) const {
+        if (entries.empty()) {
+            return;
+        }
+        int x0 = Column(area.x - max_width);
+        int x1 = Column(area.x + area.w);
+        int y0 = Row(area.y - max_height);
+        int y1 = Row(area.y + area.h);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                int cell = x + y * columns;
+                for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+                    if (SDL_HasRectIntersectionFloat(&area, &entries[i].rect)) {
+                        visit(entries[i]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    int Column(float x) const {
+        return std::clamp((int)floorf(x / cell_width), 0, columns - 1);
+    }
+    int Row(float y) const {
+        return std::clamp((int)floorf(y / cell_height), 0, rows - 1);
+    }
+
+    std::vector<Entry> staged;
+    std::vector<int> staged_cell;
+    std::vector<Entry> entries;
+    std::vector<int> cell_start;
+    float max_width;
+    float max_height;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "alignment.hpp"
+#include "aligncache.hpp"
+#include "genome.hpp"
+#include "arena.hpp"
+
+// every gene recomputed during one tick. the genes are shared copy on write,
+// so the simulation can go on mutating or destroying the organisms
+struct TraitBatch {
+    uint64_t tick = 0;
+    // genes[i] is gene gene_ids[i] at revisions[i] of organism entities[i]
+    std::vector<uint64_t> entities;
+    std::vector<int> gene_ids;
+    std::vector<uint32_t> revisions;
+    std::vector<SharedSequence> genes;
+    // filled by the worker, the hits of genes[i]
+    std::vector<std::vector<AlignmentHit>> hits;
+};
+
+// matches trait batches on its own thread. genes found in the cache are
+// answered from it, the rest of a batch goes through one AlignBatch call and
+// is added to the cache. batches finish in the order they were submitted
+class TraitWorker {
+public:
+    TraitWorker(const TraitMatcher& matcher, AlignmentCache& cache);
+    ~TraitWorker();
+    TraitWorker(const TraitWorker&) = delete;
+    TraitWorker& operator=(const TraitWorker&) = delete;
+
+    void Submit(TraitBatch batch);
+    // moves the oldest batch submitted at or before tick into out, waiting
+    // for it if it isn't done yet. false once no such batch is left
+    bool Collect(uint64_t tick, TraitBatch& out);
+    size_t Pending();
+
+private:
+    void Loop();
+    void Match(TraitBatch& batch);
+
+    const TraitMatcher& matcher;
+    AlignmentCache& cache;
+    // only touched by the worker thread, reset after every batch
+    Arena scratch;
+    std::vector<std::string_view> queries;
+    std::vector<std::vector<AlignmentHit>> aligned;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    // submitted batches in order, the first finished of them are done
+    std::deque<std::unique_ptr<TraitBatch>> queue;
+    size_t finished = 0;
+    bool stopping = false;
+    std::thread thread;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <stdint.h>
+
+#include "sequence.hpp"
+
+struct CodonEntry {
+    char codon[4];
+    char amino_acid;
+};
+
+// the standard genetic code, stops are '*'
+constexpr CodonEntry CODON_TABLE[] = {
+    {"GCT", 'A'}, {"GCC", 'A'}, {"GCA", 'A'}, {"GCG", 'A'}, // Ala
+    {"CGT", 'R'}, {"CGC", 'R'}, {"CGA", 'R'}, {"CGG", 'R'}, {"AGA", 'R'}, {"AGG", 'R'}, // Arg
+    {"AAT", 'N'}, {"AAC", 'N'}, // Asn
+    {"GAT", 'D'}, {"GAC", 'D'}, // Asp
+    {"TGT", 'C'}, {"TGC", 'C'}, // Cys
+    {"CAA", 'Q'}, {"CAG", 'Q'}, // Gln
+    {"GAA", 'E'}, {"GAG", 'E'}, // Glu
+    {"GGT", 'G'}, {"GGC", 'G'}, {"GGA", 'G'}, {"GGG", 'G'}, // Gly
+    {"CAT", 'H'}, {"CAC", 'H'}, // His
+    {"ATT", 'I'}, {"ATC", 'I'}, {"ATA", 'I'}, // Ile
+    {"TTA", 'L'}, {"TTG", 'L'}, {"CTT", 'L'}, {"CTC", 'L'}, {"CTA", 'L'}, {"CTG", 'L'}, // Leu
+    {"AAA", 'K'}, {"AAG", 'K'}, // Lys
+    {"ATG", 'M'}, // Met (start codon)
+    {"TTT", 'F'}, {"TTC", 'F'}, // Phe
+    {"CCT", 'P'}, {"CCC", 'P'}, {"CCA", 'P'}, {"CCG", 'P'}, // Pro
+    {"TCT", 'S'}, {"TCC", 'S'}, {"TCA", 'S'}, {"TCG", 'S'}, {"AGT", 'S'}, {"AGC", 'S'}, // Ser
+    {"ACT", 'T'}, {"ACC", 'T'}, {"ACA", 'T'}, {"ACG", 'T'}, // Thr
+    {"TGG", 'W'}, // Trp
+    {"TAT", 'Y'}, {"TAC", 'Y'}, // Tyr
+    {"GTT", 'V'}, {"GTC", 'V'}, {"GTA", 'V'}, {"GTG", 'V'}, // Val
+    {"TAA", '*'}, {"TAG", '*'}, {"TGA", '*'} // Stop codons
+};
+
+// residue for codons with an ambiguous base
+const char UNKNOWN_AMINO_ACID = 'X';
+
+// frames 0-2 start at that offset on the forward strand, 3-5 at offset
+// frame - 3 on the reverse complement
+const int READING_FRAMES = 6;
+
+constexpr int ConstexprBaseCode(char c) {
+    return c == 'A' ? BASE_A : c == 'C' ? BASE_C : c == 'G' ? BASE_G : c == 'T' ? BASE_T : -1;
+}
+
+// index into the 64 entry table, -1 if the codon has a letter other than ACGT
+constexpr int CodonIndex(const char* codon) {
+    int b0 = ConstexprBaseCode(codon[0]);
+    int b1 = ConstexprBaseCode(codon[1]);
+    int b2 = ConstexprBaseCode(codon[2]);
+    return b0 < 0 || b1 < 0 || b2 < 0 || codon[3] != '\0' ? -1 : 16 * b0 + 4 * b1 + b2;
+}
+
+// true if every one of the 64 codons is listed exactly once
+constexpr bool CodonTableIsComplete() {
+    int seen[64] = {};
+    for (const CodonEntry& entry : CODON_TABLE) {
+        int index = CodonIndex(entry.codon);
+        if (index < 0 || seen[index]++ > 0) {
+            return false;
+        }
+    }
+    for (int count : seen) {
+        if (count != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(sizeof(CODON_TABLE) / sizeof(CODON_TABLE[0]) == 64, "codon table needs 64 entries");
+static_assert(CodonTableIsComplete(), "every codon has to appear in the codon table exactly once");
+
+// amino acid for every codon, indexed by 16 * b0 + 4 * b1 + b2 with the
+// base codes from sequence.hpp
+constexpr std::array<char, 64> MakeCodonTable() {
+    std::array<char, 64> table{};
+    for (const CodonEntry& entry : CODON_TABLE) {
+        table[CodonIndex(entry.codon)] = entry.amino_acid;
+    }
+    return table;
+}
+
+constexpr std::array<char, 64> CODON_AMINO_ACIDS = MakeCodonTable();
+
+static_assert(CODON_AMINO_ACIDS[CodonIndex("ATG")] == 'M', "ATG has to code for Met");
+static_assert(CODON_AMINO_ACIDS[CodonIndex("AGG")] == 'R' && CODON_AMINO_ACIDS[CodonIndex("GGG")] == 'G', "Arg and Gly codons must not overlap");
+
+inline char TranslateCodon(int codon) {
+    return CODON_AMINO_ACIDS[codon];
+}
+
+// codon index of the reverse complement of a codon
+constexpr int ReverseComplementCodon(int codon) {
+    return (((codon & 3) << 4) | (codon & 12) | (codon >> 4)) ^ 63;
+}
+
+// translates one reading frame into out, which is overwritten but keeps its
+// capacity, so translating into the same buffer again doesn't allocate
+void Translate(const PackedSequence& sequence, int frame, std::string& out);
+// translates one reading frame of the bases in [begin, end) into out, which
+// needs room for (end - begin) / 3 residues. returns how many were written
+size_t TranslateRange(const PackedSequence& sequence, size_t begin, size_t end, int frame, char* out);
+void TranslateAllFrames(const PackedSequence& sequence, std::array<std::string, READING_FRAMES>& out);
+
+const char* TranslationKernelName();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed pool of worker threads, the calling thread takes part in every Run so
+// a pool of n threads spawns n - 1 workers. thread index 0 is always the caller
+class WorkerPool {
+public:
+    typedef std::function<void(int task, int thread)> Task;
+
+    explicit WorkerPool(int thread_count = DefaultThreadCount());
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    static int DefaultThreadCount();
+    int ThreadCount() const { return (int)threads.size() + 1; }
+
+    // runs fn for every task in [0, task_count) and blocks until all of them finished
+    void Run(int task_count, const Task& fn);
+    // splits [0, count) into contiguous ranges of at least min_range items and
+    // calls fn(begin, end, thread) for each of them
+    void ParallelFor(int count, int min_range, const std::function<void(int begin, int end, int thread)>& fn);
+
+private:
+    void WorkerLoop(int thread);
+    void RunTasks(int thread);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Task* job;
+    int job_size;
+    unsigned long long generation;
+    int busy;
+    bool stopping;
+    std::atomic<int> next_task;
+};
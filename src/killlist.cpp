@@ -0,0 +1,26 @@
+#include "headers/killlist.hpp"
+
+void KillList::Flush(const flecs::world& world) {
+    std::vector<flecs::entity_t>& all = deaths[0];
+    for (size_t stage = 1; stage < deaths.size(); stage++) {
+        all.insert(all.end(), deaths[stage].begin(), deaths[stage].end());
+        deaths[stage].clear();
+    }
+    // an organism can starve and be killed some other way in the same tick
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    world.defer_begin();
+    for (flecs::entity_t e : all) {
+        if (world.is_alive(e)) {
+            flecs::entity(world, e).destruct();
+        }
+    }
+    world.defer_end();
+    all.clear();
+    // pick up stages added since the last tick
+    size_t stages = world.get_stage_count();
+    if (stages > deaths.size()) {
+        claims.resize(stages);
+        deaths.resize(stages);
+    }
+}
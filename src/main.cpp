@@ -17,75 +17,109 @@ struct Organism {
 };
 
 int main(int argc, char** argv) {
-    //system("blastn -query ./assets/input.fasta -db ./assets/db.fasta -out ./assets/output.txt -outfmt 6");
-    init();
-    flecs::world world;
-    TileMap m = TileMap(WORLD_WIDTH, WORLD_HEIGHT);
-    m.CreateCurrents();
-    world.set<TileMap>(m);
-    ImGuiContext *ctx = ImGui::CreateContext();
-    bool sim_running = true;
-
-    SDL_Window* window = SDL_CreateWindow("evolution!", WINDOW_WIDTH, WINDOW_HEIGHT, 0);
-    if (window == nullptr) {
-        printf("SDL Window error: %s\n", SDL_GetError());
+    SimOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
     }
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, NULL);
-    if (renderer == nullptr) {
-        printf("SDL Renderer error: %s\n", SDL_GetError());
+    if (options.bench_translate > 0) {
+        return RunTranslateBench(options);
     }
-    SDL_Texture* Tileset = IMG_LoadTexture(renderer, "assets/tilemap.png");
-    if (Tileset == nullptr) {
-        printf("failed to create Tileset, %s", SDL_GetError());
+    WorkerPool workers(options.threads);
+    // scratch for anything that dies within the tick, reset after every world.progress()
+    TickArenas arenas(workers.ThreadCount());
+    TraitDatabase traits;
+    if (!traits.Load(TRAIT_DATABASE_PATH, &workers)) {
+        printf("couldn't read %s\n", TRAIT_DATABASE_PATH);
     }
+    TraitMatcher matcher(traits);
+    if (!options.match_path.empty()) {
+        return RunMatch(matcher, options.match_path.c_str(), workers);
+    }
+    init(options);
+    flecs::world world;
+    CounterRng rng(options.seed);
+    // the map lives only in the singleton, systems read it through a const reference
+    world.set<TileMap>(TileMap(WORLD_WIDTH, WORLD_HEIGHT));
+    world.get_mut<TileMap>().CreateCurrents(rng);
+    bool sim_running = true;
 
-    Uint64 last_frame = 0, last_physics_frame = 0;
-    flecs::query<Drawable, Size, Position> draw_entities = world.query_builder<Drawable, Size, Position>().cached().build();
-    flecs::entity organism = world.entity().set<Organism>(Organism{100}).set<Position>(Position(Vector2(0,0))).set<Size>(Size(Vector2(8,8))).set<Drawable>(Drawable{0xFF,0xFF,0xFF,0xFF}).set<Velocity>(Velocity(Vector2(0,0))).add<CurrentInteractable>();
-    world.system<Position, CurrentInteractable>().each([world] (Position& p, CurrentInteractable) {
-        TileMap m = world.get<TileMap>();
-        Vector2 current = m.GetCurrentAt(p.v / Vector2(TILE_WIDTH, TILE_HEIGHT));
-        if (!std::isnan(current.x)) {
-            p.v.x += current.x;
-        }
-        if (!std::isnan(current.y)) {
-            p.v.y += current.y;
+    flecs::entity organism = world.entity().set<Organism>(Organism{100}).set<Genome>(LoadGenome(FOUNDER_GENOME_PATH, workers)).add<GenomeChanged>().set<Position>(Position(Vector2(0,0))).set<PreviousPosition>(PreviousPosition(Vector2(0,0))).set<Size>(Size(Vector2(8,8))).set<Drawable>(Drawable{0xFF,0xFF,0xFF,0xFF}).set<Velocity>(Velocity(Vector2(0,0))).add<CurrentInteractable>();
+    world.system<PreviousPosition, const Position>("snapshot positions").kind(flecs::PreUpdate).each([](PreviousPosition& prev, const Position& p) {
+        prev.v = p.v;
+    });
+    world.system<Position>("follow currents").with<CurrentInteractable>().run([world](flecs::iter& it) {
+        const TileMap& map = world.get<TileMap>();
+        while (it.next()) {
+            auto f_p = it.field<Position>(0);
+            for (auto i : it) {
+                Position& p = f_p[i];
+                Vector2 current = map.SampleCurrent(p.v / Vector2(TILE_WIDTH, TILE_HEIGHT));
+                if (!std::isnan(current.x)) {
+                    p.v.x += current.x;
+                }
+                if (!std::isnan(current.y)) {
+                    p.v.y += current.y;
+                }
+            }
         }
     });
-    world.system<TileMap>().each([](TileMap& t) {
-        t.UpdateCurrents();
-        t.ApplyNoise();
+    world.system<TileMap>().each([&workers, rng, world](TileMap& t) {
+        t.UpdateCurrents(workers);
+        t.ApplyNoise(workers, rng, world.get_info()->frame_count_total);
     });
-    world.system("food spawner").interval(1).run_each([world](){
+    world.system("food spawner").interval(1).run_each([world, rng](){
+        RngBlock r = rng.Block(RngStream::FOOD_SPAWN, world.get_info()->frame_count_total, 0);
         world.entity()
         .add<Food>()
-        .set<Position>(Position(Vector2(SDL_rand(WORLD_WIDTH * TILE_WIDTH), SDL_rand(WORLD_HEIGHT * TILE_HEIGHT))))
+        .set<Position>(Position(Vector2((int)(UniformFloat(r.w[0]) * WORLD_WIDTH * TILE_WIDTH), (int)(UniformFloat(r.w[1]) * WORLD_HEIGHT * TILE_HEIGHT))))
         .set<Drawable>(Drawable{0xFF,0x0,0x0,0xFF})
         .set<Size>(Size(Vector2(4,4)));
     });
-    world.system<Position, Size>().kind(flecs::OnValidate).each([m](Position& p, Size& s) {
-        if (p.v.x < 0) {
-            p.v.x = 0;
-        }
-        else if (p.v.x + s.v.x > m.width * TILE_WIDTH) {
-            p.v.x = m.width * TILE_WIDTH - 1 - s.v.x;
-        }
-        if (p.v.y < 0) {    
-            p.v.y = 0;
+    world.system<Position, const Size>("world bounds").kind(flecs::OnValidate).run([world](flecs::iter& it) {
+        const TileMap& map = world.get<TileMap>();
+        while (it.next()) {
+            auto f_p = it.field<Position>(0);
+            auto f_s = it.field<const Size>(1);
+            for (auto i : it) {
+                Position& p = f_p[i];
+                const Size& s = f_s[i];
+                if (p.v.x < 0) {
+                    p.v.x = 0;
+                }
+                else if (p.v.x + s.v.x > map.width * TILE_WIDTH) {
+                    p.v.x = map.width * TILE_WIDTH - 1 - s.v.x;
+                }
+                if (p.v.y < 0) {
+                    p.v.y = 0;
+                }
+                else if (p.v.y + s.v.y > map.height * TILE_HEIGHT) {
+                    p.v.y = map.height * TILE_HEIGHT - 1 - s.v.y;
+                }
+            }
         }
-        else if (p.v.y + s.v.y > m.height * TILE_HEIGHT) {
-            p.v.y = m.height * TILE_HEIGHT - 1 - s.v.y;
+    });
+    SpatialGrid food_grid(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT);
+    world.system<const Size, const Position>("food index").with<Food>().run([&food_grid](flecs::iter& it) {
+        food_grid.Clear();
+        while (it.next()) {
+            auto f_s = it.field<const Size>(0);
+            auto f_p = it.field<const Position>(1);
+            for (auto i : it) {
+                food_grid.Insert(it.entity(i), SDL_FRect{f_p[i].v.x, f_p[i].v.y, f_s[i].v.x, f_s[i].v.y});
+            }
         }
+        food_grid.Build();
     });
-    flecs::query<Food, Size, Position> collison = world.query<Food, Size, Position>();
-    world.system<Organism, Size, Position>().each([&collison](Organism& o, Size& o_s, Position& o_p) {
+    KillList kills(world.get_stage_count());
+    world.system<Organism, Size, Position>().each([&food_grid, &kills](flecs::entity e, Organism&, Size& o_s, Position& o_p) {
         SDL_FRect organism_rect{o_p.v.x, o_p.v.y,o_s.v.x, o_s.v.y};
-        collison.each([&organism_rect, &o](flecs::entity e, Food f, const Size& f_s, const Position& f_p){
-            SDL_FRect food_rect{f_p.v.x, f_p.v.y,f_s.v.x, f_s.v.y};
-            if (SDL_HasRectIntersectionFloat(&organism_rect, &food_rect)) {
-                e.destruct();
-                o.energy += 10;
-            }
+        food_grid.Query(organism_rect, [&e, &kills](const SpatialGrid::Entry& food) {
+            kills.Claim(e.world().get_stage_id(), food.id, e);
+        });
+    });
+    world.system("food claims").run_each([&kills, world]() {
+        kills.ResolveClaims([world](flecs::entity_t organism) {
+            flecs::entity(world, organism).get_mut<Organism>().energy += 10;
         });
     });
     world.system<Position, Velocity>().each([](flecs::entity e, Position& p, Velocity& v) {
@@ -97,11 +131,238 @@ int main(int argc, char** argv) {
             }
         }
     });
-    world.system<Organism>().each([](flecs::entity e, Organism& o) {
+    world.system<Organism>().each([&kills](flecs::entity e, Organism& o) {
         if (o.energy < 0) {
-            e.destruct();
+            kills.Kill(e.world().get_stage_id(), e);
+        }
+    });
+    // bacterial -10 and -35 boxes and the lac operator
+    // the boxes are only 6 bases, so a mismatched one is mostly chance and
+    // counts for little
+    std::vector<Promoter> promoters = {Promoter("TATAAT", 0.8, 0.95), Promoter("TTGACA", 0.6, 0.95)};
+    std::vector<Inhibitor> inhibitors = {Inhibitor("AATTGTGAGCGGATAACAATT", 0.9, 0.7)};
+    MotifScanner motifs(promoters, inhibitors);
+    // a gene whose chance promoter sites alone reach full expression can't
+    // tell real promoters apart from noise
+    for (const GenomeFragment& fragment : organism.get<Genome>().fragments) {
+        size_t length = fragment.nucleotides->size();
+        double chance = EXPRESSION_BASAL + motifs.ChanceWeight(MotifKind::PROMOTER, length);
+        if (chance >= 1) {
+            printf("promoters saturate a %zu base gene by chance alone (%.2f), raise their specificity\n", length, chance);
+        }
+    }
+    world.system<const Genome>("expression").with<GenomeChanged>().run([&motifs, &arenas](flecs::iter& it) {
+        while (it.next()) {
+            auto f_g = it.field<const Genome>(0);
+            for (auto i : it) {
+                it.entity(i).set<Expression>(Express(f_g[i], motifs, arenas.Main())).add<TraitsPending>().remove<GenomeChanged>();
+            }
+        }
+    });
+    world.system<Genome, Expression>("mutation").run([&motifs, &arenas, rng, world, mutation_rate = options.mutation_rate](flecs::iter& it) {
+        uint64_t tick = world.get_info()->frame_count_total;
+        ArenaVector<Mutation> mutations{ArenaAllocator<Mutation>(arenas.Main())};
+        while (it.next()) {
+            auto f_g = it.field<Genome>(0);
+            auto f_e = it.field<Expression>(1);
+            for (auto i : it) {
+                Genome& genome = f_g[i];
+                size_t total = 0;
+                for (const GenomeFragment& fragment : genome.fragments) {
+                    total += fragment.nucleotides->size();
+                }
+                // every base of the organism mutates independently, on a
+                // stream of draws of its own
+                mutations.clear();
+                int fragment = 0;
+                size_t fragment_start = 0;
+                SampleBernoulli(rng, RngStream::MUTATION, tick, (uint64_t)(uint32_t)it.entity(i).id() << 32, 0, (int)total, mutation_rate, [&](int base, const RngBlock& r) {
+                    while ((size_t)base >= fragment_start + genome.fragments[fragment].nucleotides->size()) {
+                        fragment_start += genome.fragments[fragment++].nucleotides->size();
+                    }
+                    // mostly substitutions, a tenth each insertions and deletions
+                    Mutation mutation{fragment, base - fragment_start, 1, std::string(1, BASE_LETTERS[r.w[2] & 3])};
+                    uint32_t kind = r.w[1] % 10;
+                    uint32_t length = 1 + r.w[3] % MUTATION_MAX_INDEL;
+                    if (kind == 8) {
+                        mutation.removed = 0;
+                        for (uint32_t k = 1; k < length; k++) {
+                            mutation.inserted += BASE_LETTERS[(r.w[2] >> (2 * k)) & 3];
+                        }
+                    }
+                    else if (kind == 9) {
+                        mutation.removed = length;
+                        mutation.inserted.clear();
+                    }
+                    mutations.push_back(std::move(mutation));
+                });
+                // last first, so the positions of the ones before stay valid
+                for (auto m = mutations.rbegin(); m != mutations.rend(); ++m) {
+                    Mutate(genome, f_e[i], motifs, *m, arenas.Main());
+                }
+                if (!mutations.empty()) {
+                    it.entity(i).add<TraitsPending>();
+                }
+            }
+        }
+    });
+    ConjugationPlanner conjugation(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT);
+    std::vector<Genome*> conjugation_genomes;
+    std::vector<Expression*> conjugation_expressions;
+    std::vector<PlasmidTransfer> transfers;
+    std::vector<uint8_t> transferred;
+    world.system<Genome, Expression, const Size, const Position>("conjugation").with<Organism>().run([&conjugation, &conjugation_genomes, &conjugation_expressions, &transfers, &transferred, &workers, &arenas, &motifs, rng, world](flecs::iter& it) {
+        conjugation.Clear();
+        conjugation_genomes.clear();
+        conjugation_expressions.clear();
+        while (it.next()) {
+            auto f_g = it.field<Genome>(0);
+            auto f_e = it.field<Expression>(1);
+            auto f_s = it.field<const Size>(2);
+            auto f_p = it.field<const Position>(3);
+            for (auto i : it) {
+                int plasmids = 0;
+                for (const GenomeFragment& fragment : f_g[i].fragments) {
+                    plasmids += fragment.type == GenomeFragment::GenomeFragmentType::PLASMID;
+                }
+                conjugation.Add(it.entity(i), SDL_FRect{f_p[i].v.x, f_p[i].v.y, f_s[i].v.x, f_s[i].v.y}, plasmids);
+                // component storage stays put until the deferred changes of this tick are merged
+                conjugation_genomes.push_back(&f_g[i]);
+                conjugation_expressions.push_back(&f_e[i]);
+            }
+        }
+        conjugation.Plan(workers, arenas, rng, world.get_info()->frame_count_total, transfers);
+        // every organism is in at most one transfer, so they all run side by side
+        transferred.assign(transfers.size(), 0);
+        workers.ParallelFor((int)transfers.size(), CONJUGATION_RANGE, [&](int begin, int end, int thread) {
+            Arena& arena = arenas.Thread(thread);
+            for (int t = begin; t < end; t++) {
+                const Genome& donor = *conjugation_genomes[transfers[t].donor];
+                Genome& recipient = *conjugation_genomes[transfers[t].recipient];
+                ArenaVector<int> plasmids{ArenaAllocator<int>(arena)};
+                for (size_t f = 0; f < donor.fragments.size(); f++) {
+                    if (donor.fragments[f].type == GenomeFragment::GenomeFragmentType::PLASMID) {
+                        plasmids.push_back((int)f);
+                    }
+                }
+                const GenomeFragment& plasmid = donor.fragments[plasmids[transfers[t].choice % plasmids.size()]];
+                // the recipient already carries it
+                bool carried = std::any_of(recipient.fragments.begin(), recipient.fragments.end(), [&](const GenomeFragment& fragment) {
+                    return &*fragment.nucleotides == &*plasmid.nucleotides || *fragment.nucleotides == *plasmid.nucleotides;
+                });
+                if (!carried) {
+                    // the copy shares the donor's bases until either side mutates them
+                    AddFragment(recipient, *conjugation_expressions[transfers[t].recipient], motifs, plasmid, arena);
+                    transferred[t] = 1;
+                }
+            }
+        });
+        for (size_t t = 0; t < transfers.size(); t++) {
+            if (transferred[t]) {
+                flecs::entity(world, conjugation.Entity(transfers[t].recipient)).add<TraitsPending>();
+            }
+        }
+    });
+    AlignmentCache trait_cache;
+    TraitWorker trait_worker(matcher, trait_cache);
+    world.system<Expression, const Genome>("trait matching").with<TraitsPending>().run([&trait_worker, world](flecs::iter& it) {
+        TraitBatch batch;
+        batch.tick = world.get_info()->frame_count_total;
+        while (it.next()) {
+            auto f_e = it.field<Expression>(0);
+            auto f_g = it.field<const Genome>(1);
+            for (auto i : it) {
+                Expression& expression = f_e[i];
+                for (int g : expression.unmatched) {
+                    const ExpressedGene& gene = expression.genes[g];
+                    batch.entities.push_back(it.entity(i));
+                    batch.gene_ids.push_back(g);
+                    batch.revisions.push_back(gene.revision);
+                    const SharedSequence& bases = f_g[i].fragments[gene.fragment].nucleotides;
+                    // a gene spanning its whole fragment is shared with the worker instead of copied
+                    if (gene.start == 0 && gene.end == bases->size()) {
+                        batch.genes.push_back(bases);
+                    }
+                    else {
+                        batch.genes.push_back(SharedSequence(bases->Substr(gene.start, gene.end - gene.start)));
+                    }
+                }
+                expression.unmatched.clear();
+                it.entity(i).remove<TraitsPending>();
+            }
+        }
+        if (!batch.entities.empty()) {
+            trait_worker.Submit(std::move(batch));
+        }
+    });
+    world.system("trait results").run_each([&trait_worker, &arenas, world]() {
+        uint64_t tick = world.get_info()->frame_count_total;
+        TraitBatch batch;
+        ArenaVector<uint64_t> updated{ArenaAllocator<uint64_t>(arenas.Main())};
+        while (tick >= TRAIT_MATCH_LATENCY && trait_worker.Collect(tick - TRAIT_MATCH_LATENCY, batch)) {
+            for (size_t i = 0; i < batch.entities.size(); i++) {
+                flecs::entity e(world, batch.entities[i]);
+                Expression* expression = e.is_alive() ? e.try_get_mut<Expression>() : nullptr;
+                if (expression == nullptr || batch.gene_ids[i] >= (int)expression->genes.size()) {
+                    continue;
+                }
+                // a gene mutated again after this was submitted is already queued with its new revision
+                ExpressedGene& gene = expression->genes[batch.gene_ids[i]];
+                if (gene.revision == batch.revisions[i]) {
+                    gene.hits = std::move(batch.hits[i]);
+                    updated.push_back(batch.entities[i]);
+                }
+            }
+        }
+        // only the organisms whose genes changed gather their trait hits again
+        std::sort(updated.begin(), updated.end());
+        updated.erase(std::unique(updated.begin(), updated.end()), updated.end());
+        for (uint64_t id : updated) {
+            flecs::entity e(world, id);
+            TraitHits traits;
+            for (const ExpressedGene& gene : e.get<Expression>().genes) {
+                traits.hits.insert(traits.hits.end(), gene.hits.begin(), gene.hits.end());
+            }
+            e.set<TraitHits>(std::move(traits));
+        }
+    });
+    world.system("kill list").kind(flecs::OnStore).run_each([&kills, world]() {
+        kills.Flush(world);
+    });
+    if (options.headless) {
+        return RunHeadless(world, arenas, options);
+    }
+
+    ImGuiContext *ctx = ImGui::CreateContext();
+    SDL_Window* window = SDL_CreateWindow("evolution!", WINDOW_WIDTH, WINDOW_HEIGHT, 0);
+    if (window == nullptr) {
+        printf("SDL Window error: %s\n", SDL_GetError());
+    }
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, NULL);
+    if (renderer == nullptr) {
+        printf("SDL Renderer error: %s\n", SDL_GetError());
+    }
+    SDL_Texture* Tileset = IMG_LoadTexture(renderer, "assets/tilemap.png");
+    if (Tileset == nullptr) {
+        printf("failed to create Tileset, %s", SDL_GetError());
+    }
+    SpatialGrid draw_grid(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT);
+    world.system<const Size, const Position>("draw index").with<Drawable>().kind(flecs::OnStore).run([&draw_grid](flecs::iter& it) {
+        draw_grid.Clear();
+        while (it.next()) {
+            auto s = it.field<const Size>(0);
+            auto p = it.field<const Position>(1);
+            for (auto i : it) {
+                draw_grid.Insert(it.entity(i), SDL_FRect{p[i].v.x, p[i].v.y, s[i].v.x, s[i].v.y});
+            }
         }
+        draw_grid.Build();
     });
+    RectBatch entity_batch;
+    TerrainLayer terrain(world.get<TileMap>().width, world.get<TileMap>().height, TILE_WIDTH, TILE_HEIGHT);
+    Camera camera;
+
+    Uint64 last_frame = 0, last_tick = SDL_GetTicksNS(), physics_accumulator = 0;
     SDL_Event event;
     ImGui_ImplSDL3_InitForSDLRenderer(window, renderer);
     ImGui_ImplSDLRenderer3_Init(renderer);
@@ -113,6 +374,23 @@ int main(int argc, char** argv) {
                 case SDL_EVENT_QUIT:
                     sim_running = false;
                     break;
+                case SDL_EVENT_RENDER_TARGETS_RESET:
+                    terrain.MarkAllDirty();
+                    break;
+                case SDL_EVENT_RENDER_DEVICE_RESET:
+                    // the chunk textures died with the device, redrawing them isn't enough
+                    terrain.Release();
+                    break;
+                case SDL_EVENT_MOUSE_WHEEL:
+                    if (!ImGui::GetIO().WantCaptureMouse) {
+                        camera.ZoomAt(powf(1.1f, event.wheel.y), event.wheel.mouse_x, event.wheel.mouse_y);
+                    }
+                    break;
+                case SDL_EVENT_MOUSE_MOTION:
+                    if ((event.motion.state & (SDL_BUTTON_RMASK | SDL_BUTTON_MMASK)) && !ImGui::GetIO().WantCaptureMouse) {
+                        camera.Pan(event.motion.xrel, event.motion.yrel);
+                    }
+                    break;
                 case SDL_EVENT_KEY_DOWN:
                 case SDL_EVENT_KEY_UP:
                     if (organism.is_alive()) { 
@@ -135,12 +413,23 @@ int main(int argc, char** argv) {
                     }
             }
         }
-        Uint64 current_tick = SDL_GetTicks();
-        if (current_tick - last_physics_frame >= 1 * 1000 / MAX_PHYSICS_FPS) {
-            world.progress();
-            last_physics_frame = current_tick;
+        Uint64 now = SDL_GetTicksNS();
+        physics_accumulator += now - last_tick;
+        last_tick = now;
+        int steps = 0;
+        while (physics_accumulator >= PHYSICS_STEP_NS && steps < MAX_PHYSICS_CATCH_UP) {
+            world.progress(PHYSICS_STEP_NS / 1e9f);
+            arenas.Reset();
+            physics_accumulator -= PHYSICS_STEP_NS;
+            steps++;
+        }
+        if (physics_accumulator >= PHYSICS_STEP_NS) {
+            // too far behind to ever catch up, drop the backlog instead of spiraling
+            physics_accumulator %= PHYSICS_STEP_NS;
         }
-        if (current_tick - last_frame >= 1 * 1000 / MAX_FPS) {
+        // how far between the last two physics steps this frame is drawn
+        float alpha = physics_accumulator / (float)PHYSICS_STEP_NS;
+        if (now - last_frame >= FRAME_NS) {
             SDL_SetRenderDrawColor(renderer, 0x0, 0x0, 0x0, 0x0);
             ImGui_ImplSDLRenderer3_NewFrame();
             ImGui_ImplSDL3_NewFrame();
@@ -150,40 +439,136 @@ int main(int argc, char** argv) {
             ImGui::TextColored(ImVec4{1,1,1,1}, "energy: %f", organism.get<Organism>().energy);
             ImGui::TextColored(ImVec4{1,1,1,1}, "position: (%.2f,%.2f)", organism.get<Position>().v.x, organism.get<Position>().v.y);
             }
-            SDL_RenderClear(renderer);
-            for (int i = 0; i < m.terrains.size(); i++) {
-                Sprite s = atlas.at(TexturedEnum(m.terrains[i]));
-                const SDL_FRect src = ReadAtlas(s);
-                const SDL_FRect dst{i % m.width * (float)TILE_WIDTH, i / m.width * (float)TILE_HEIGHT, (float)TILE_WIDTH, TILE_HEIGHT};
-                if (dst.x + dst.w > 0 && dst.x < m.width * TILE_WIDTH && dst.y + dst.h > 0 && dst.y < m.height * TILE_HEIGHT) {
-                    SDL_RenderTexture(renderer, Tileset, &src, &dst);
-                }  
-            }
-            draw_entities.each([renderer](Drawable& d, Size& s, Position& p) {
-                SDL_FRect rect = (SDL_FRect{p.v.x,p.v.y,s.v.x,s.v.y});
-                const SDL_FRect* rp = &rect;
-                SDL_SetRenderDrawColor(renderer, d.r,d.g,d.b,d.a);
-                SDL_RenderFillRect(renderer, rp);
+            uint64_t cache_lookups = trait_cache.Hits() + trait_cache.Misses();
+            ImGui::TextColored(ImVec4{1,1,1,1}, "trait cache: %llu hits, %llu misses (%.1f%%)", (unsigned long long)trait_cache.Hits(), (unsigned long long)trait_cache.Misses(), cache_lookups > 0 ? 100.0 * trait_cache.Hits() / cache_lookups : 0.0);
+            ImGui::TextColored(ImVec4{1,1,1,1}, "tick arenas: %zu KB", arenas.Capacity() / 1024);
+            ImGui::TextColored(ImVec4{1,1,1,1}, "kernels: diffuse %s, translate %s, profile %s, align %s", DiffuseKernelName(), TranslationKernelName(), ProfileKernelName(), BatchKernelName());
+            ImGui::TextColored(ImVec4{1,1,1,1}, "zoom: %.2f%s", camera.zoom, camera.zoom < LOD_ZOOM ? " (density)" : "");
+            if (ImGui::Button("reset view")) {
+                camera = Camera();
+            }
+            TileMap& map = world.get_mut<TileMap>();
+            for (int tile : map.dirty_terrain) {
+                terrain.MarkDirty(tile);
+            }
+            map.dirty_terrain.clear();
+            terrain.Update(renderer, Tileset, [&map](int tile) {
+                return ReadAtlas(atlas.at(TexturedEnum(map.terrains[tile])));
             });
+            SDL_RenderClear(renderer);
+            int screen_width, screen_height;
+            SDL_GetRenderOutputSize(renderer, &screen_width, &screen_height);
+            SDL_FRect visible = camera.Visible(screen_width, screen_height);
+            terrain.Draw(renderer, camera, visible);
+            if (camera.zoom < LOD_ZOOM) {
+                DrawDensity(entity_batch, draw_grid, camera, visible);
+            }
+            else {
+                // the grid holds positions from the end of the last step, interpolation can pull them back a bit
+                SDL_FRect cull{visible.x - CULL_MARGIN, visible.y - CULL_MARGIN, visible.w + 2 * CULL_MARGIN, visible.h + 2 * CULL_MARGIN};
+                draw_grid.Query(cull, [&world, &entity_batch, &camera, alpha](const SpatialGrid::Entry& entry) {
+                    flecs::entity e(world, entry.id);
+                    if (!e.is_alive()) {
+                        return;
+                    }
+                    const Drawable& d = e.get<Drawable>();
+                    const PreviousPosition* prev = e.try_get<PreviousPosition>();
+                    Vector2 p(entry.rect.x, entry.rect.y);
+                    Vector2 v = prev ? prev->v + (p - prev->v) * alpha : p;
+                    entity_batch.Add(camera.ToScreen(SDL_FRect{v.x, v.y, entry.rect.w, entry.rect.h}), d.r, d.g, d.b, d.a);
+                });
+            }
+            entity_batch.Submit(renderer);
             SDL_SetRenderDrawColor(renderer, 0xFF, 0x0, 0xFF, 0xFF);
-            last_frame = current_tick;
+            last_frame = now;
             ImGui::End();
             ImGui::Render();
             ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), renderer);
             SDL_RenderPresent(renderer);
         }
     }
+    terrain.Release();
     SDL_DestroyTexture(Tileset);
     return cleanup(window, renderer, ctx);
 }
-void init()
+void init(const SimOptions& options)
 {
-    if (!SDL_Init(SDL_INIT_VIDEO)) {
+    if (!SDL_Init(options.headless ? 0 : SDL_INIT_VIDEO)) {
         printf("err: %s", SDL_GetError());
     }
     IMGUI_CHECKVERSION();
 }
 
+void PrintUsage(const char* program) {
+    printf("usage: %s [--headless] [--ticks N] [--until-extinct] [--seed N] [--threads N] [--mutation-rate P] [--match FILE] [--bench-translate [N]]\n", program);
+    printf("  --headless       run without a window, as many ticks per second as possible\n");
+    printf("  --ticks N        stop after N ticks (headless only, 0 runs forever)\n");
+    printf("  --until-extinct  stop once no organism is left (headless only)\n");
+    printf("  --seed N         seed for every random stream\n");
+    printf("  --threads N      worker threads for the field updates, including the main thread\n");
+    printf("  --mutation-rate P  chance per base and tick that it mutates\n");
+    printf("  --match FILE     align every sequence in a fasta file against the traits, print blast -outfmt 6 rows and exit\n");
+    printf("  --bench-translate [N]  time a hashed codon lookup against Translate on N random codons and exit\n");
+}
+
+bool ParseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--until-extinct") {
+            options.until_extinct = true;
+        }
+        else if (arg == "--ticks" && has_value) {
+            options.ticks = strtoll(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--seed" && has_value) {
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--threads" && has_value) {
+            options.threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--mutation-rate" && has_value) {
+            options.mutation_rate = strtof(argv[++i], nullptr);
+        }
+        else if (arg == "--match" && has_value) {
+            options.match_path = argv[++i];
+        }
+        else if (arg == "--bench-translate") {
+            options.bench_translate = BENCH_TRANSLATE_CODONS;
+            if (has_value && isdigit((unsigned char)argv[i + 1][0])) {
+                options.bench_translate = std::max(1LL, strtoll(argv[++i], nullptr, 10));
+            }
+        }
+        else {
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// fixed step ticks back to back with no rendering, reports the tick rate at the end
+int RunHeadless(flecs::world& world, TickArenas& arenas, const SimOptions& options) {
+    Uint64 start = SDL_GetTicksNS();
+    long long ticks = 0;
+    while (options.ticks == 0 || ticks < options.ticks) {
+        world.progress(PHYSICS_STEP_NS / 1e9f);
+        arenas.Reset();
+        ticks++;
+        if (options.until_extinct && world.count<Organism>() == 0) {
+            break;
+        }
+    }
+    double seconds = (SDL_GetTicksNS() - start) / 1e9;
+    printf("%lld ticks in %.3fs (%.1f ticks/s), %d organisms, %d food\n", ticks, seconds, seconds > 0 ? ticks / seconds : 0.0, world.count<Organism>(), world.count<Food>());
+    printf("kernels: diffuse %s, translate %s, profile %s, align %s\n", DiffuseKernelName(), TranslationKernelName(), ProfileKernelName(), BatchKernelName());
+    SDL_Quit();
+    return 0;
+}
+
 int cleanup(SDL_Window* window, SDL_Renderer* renderer, ImGuiContext* ctx) {
     ImGui_ImplSDLRenderer3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
@@ -195,4 +580,81 @@ int cleanup(SDL_Window* window, SDL_Renderer* renderer, ImGuiContext* ctx) {
 
 SDL_FRect ReadAtlas(Sprite s) {
     return SDL_FRect{s.x * ATLAS_TILE_WIDTH, s.y * ATLAS_TILE_WIDTH, (float)s.horizontal_tile_count * ATLAS_TILE_WIDTH, (float)s.vertical_tile_count * ATLAS_TILE_HEIGHT};
-}
\ No newline at end of file
+}
+
+Genome LoadGenome(const char* path, WorkerPool& workers) {
+    Genome genome;
+    FastaFile file;
+    if (!file.Open(path, &workers)) {
+        printf("couldn't read %s\n", path);
+        return genome;
+    }
+    std::string scratch;
+    for (const FastaRecordView& record : file.Records()) {
+        // records named as plasmids are the ones organisms pass on to each other
+        bool plasmid = record.header.find("plasmid") != std::string_view::npos;
+        genome.fragments.push_back(GenomeFragment{SharedSequence(PackedSequence(record.Sequence(scratch))), plasmid ? GenomeFragment::GenomeFragmentType::PLASMID : GenomeFragment::GenomeFragmentType::CHROMOSOME});
+    }
+    return genome;
+}
+
+int RunMatch(const TraitMatcher& matcher, const char* path, WorkerPool& workers) {
+    FastaFile queries;
+    if (!queries.Open(path, &workers)) {
+        printf("couldn't read %s\n", path);
+        return 1;
+    }
+    std::vector<AlignmentHit> hits;
+    std::string scratch;
+    for (const FastaRecordView& query : queries.Records()) {
+        hits.clear();
+        matcher.Align(query.Sequence(scratch), hits);
+        for (const AlignmentHit& hit : hits) {
+            printf("%s\n", matcher.Format(query.id, hit).c_str());
+        }
+    }
+    return 0;
+}
+
+// the codon lookup Translate replaced, a hash of every substr()'d codon,
+// timed against Translate on the same random bases
+int RunTranslateBench(const SimOptions& options) {
+    size_t codons = (size_t)options.bench_translate;
+    CounterRng rng(options.seed);
+    std::string bases(codons * 3, 'A');
+    for (size_t i = 0; i < bases.size(); i += 64) {
+        RngBlock r = rng.Block(RngStream::BENCHMARK, 0, i / 64);
+        for (size_t j = 0; j < 64 && i + j < bases.size(); j++) {
+            bases[i + j] = BASE_LETTERS[(r.w[j / 16] >> (2 * (j % 16))) & 3];
+        }
+    }
+    PackedSequence sequence(bases);
+
+    std::unordered_map<std::string, char> table;
+    for (const CodonEntry& entry : CODON_TABLE) {
+        table[entry.codon] = entry.amino_acid;
+    }
+    std::string hashed;
+    hashed.reserve(codons);
+    Uint64 start = SDL_GetTicksNS();
+    for (size_t i = 0; i + 3 <= bases.size(); i += 3) {
+        auto it = table.find(bases.substr(i, 3));
+        hashed += it != table.end() ? it->second : UNKNOWN_AMINO_ACID;
+    }
+    Uint64 hashed_ns = SDL_GetTicksNS() - start;
+
+    std::string translated;
+    start = SDL_GetTicksNS();
+    Translate(sequence, 0, translated);
+    Uint64 translated_ns = SDL_GetTicksNS() - start;
+
+    bool identical = hashed == translated;
+    auto rate = [&](Uint64 ns) {
+        return ns > 0 ? codons / (ns / 1e9) / 1e6 : 0.0;
+    };
+    printf("%zu codons\n", codons);
+    printf("hashed substr: %.3f ms (%.1fM codons/s)\n", hashed_ns / 1e6, rate(hashed_ns));
+    printf("Translate (%s): %.3f ms (%.1fM codons/s)\n", TranslationKernelName(), translated_ns / 1e6, rate(translated_ns));
+    printf("output %s\n", identical ? "identical" : "differs");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include "headers/protein.hpp"
+
+#include <algorithm>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROTEIN_X86
+#include <immintrin.h>
+#endif
+
+// residues summed side by side, each lane adds every 8th residue so the
+// scalar and vector paths add in exactly the same order
+const int PROFILE_LANES = 8;
+
+typedef float PropertyLanes[PROPERTY_COUNT][PROFILE_LANES];
+
+// sums the properties of the first count / 8 * 8 residues into lanes
+static void SumLanesScalar(const char* data, size_t count, PropertyLanes& lanes) {
+    for (size_t i = 0; i + PROFILE_LANES <= count; i += PROFILE_LANES) {
+        for (int p = 0; p < PROPERTY_COUNT; p++) {
+            const float* column = PROPERTY_TABLES.columns[p].data();
+            for (int k = 0; k < PROFILE_LANES; k++) {
+                lanes[p][k] += column[(uint8_t)data[i + k]];
+            }
+        }
+    }
+}
+
+#ifdef PROTEIN_X86
+__attribute__((target("avx2")))
+static void SumLanesAVX2(const char* data, size_t count, PropertyLanes& lanes) {
+    __m256 sums[PROPERTY_COUNT];
+    for (int p = 0; p < PROPERTY_COUNT; p++) {
+        sums[p] = _mm256_loadu_ps(lanes[p]);
+    }
+    for (size_t i = 0; i + PROFILE_LANES <= count; i += PROFILE_LANES) {
+        __m256i residues = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(data + i)));
+        for (int p = 0; p < PROPERTY_COUNT; p++) {
+            sums[p] = _mm256_add_ps(sums[p], _mm256_i32gather_ps(PROPERTY_TABLES.columns[p].data(), residues, 4));
+        }
+    }
+    for (int p = 0; p < PROPERTY_COUNT; p++) {
+        _mm256_storeu_ps(lanes[p], sums[p]);
+    }
+}
+#endif
+
+typedef void (*SumLanesKernel)(const char* data, size_t count, PropertyLanes& lanes);
+
+static SumLanesKernel SelectSumLanesKernel() {
+#ifdef PROTEIN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return SumLanesAVX2;
+    }
+#endif
+    return SumLanesScalar;
+}
+
+static const SumLanesKernel sum_lanes = SelectSumLanesKernel();
+
+const char* ProfileKernelName() {
+#ifdef PROTEIN_X86
+    if (sum_lanes == SumLanesAVX2) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+// calls visit with the average of every window in order, a protein shorter
+// than the window is one window of its full length
+template <typename Visit>
+static void ForEachWindow(std::string_view protein, AminoAcidProperty property, int window, Visit visit) {
+    size_t width = std::min((size_t)std::max(window, 1), protein.size());
+    if (width == 0) {
+        return;
+    }
+    const float* column = PROPERTY_TABLES.columns[(int)property].data();
+    float sum = 0.0f;
+    for (size_t i = 0; i < width; i++) {
+        sum += column[(uint8_t)protein[i]];
+    }
+    visit(sum / width);
+    for (size_t i = width; i < protein.size(); i++) {
+        sum += column[(uint8_t)protein[i]] - column[(uint8_t)protein[i - width]];
+        visit(sum / width);
+    }
+}
+
+ProteinProfile ComputeProfile(std::string_view protein, int window) {
+    ProteinProfile profile = {};
+    profile.length = (int)protein.size();
+    if (protein.empty()) {
+        return profile;
+    }
+    PropertyLanes lanes = {};
+    sum_lanes(protein.data(), protein.size(), lanes);
+    float sums[PROPERTY_COUNT];
+    size_t tail = protein.size() / PROFILE_LANES * PROFILE_LANES;
+    for (int p = 0; p < PROPERTY_COUNT; p++) {
+        float sum = 0.0f;
+        for (int k = 0; k < PROFILE_LANES; k++) {
+            sum += lanes[p][k];
+        }
+        for (size_t i = tail; i < protein.size(); i++) {
+            sum += PROPERTY_TABLES.columns[p][(uint8_t)protein[i]];
+        }
+        sums[p] = sum;
+    }
+    float length = (float)protein.size();
+    profile.mean_hydrophobicity = sums[(int)AminoAcidProperty::HYDROPHOBICITY] / length;
+    profile.net_charge = sums[(int)AminoAcidProperty::CHARGE];
+    profile.mean_polarity = sums[(int)AminoAcidProperty::POLARITY] / length;
+    profile.mean_size = sums[(int)AminoAcidProperty::SIZE] / length;
+
+    profile.max_window_hydrophobicity = -INFINITY;
+    profile.min_window_hydrophobicity = INFINITY;
+    ForEachWindow(protein, AminoAcidProperty::HYDROPHOBICITY, window, [&](float average) {
+        profile.max_window_hydrophobicity = std::max(profile.max_window_hydrophobicity, average);
+        profile.min_window_hydrophobicity = std::min(profile.min_window_hydrophobicity, average);
+    });
+    profile.max_window_charge = -INFINITY;
+    profile.min_window_charge = INFINITY;
+    ForEachWindow(protein, AminoAcidProperty::CHARGE, window, [&](float average) {
+        profile.max_window_charge = std::max(profile.max_window_charge, average);
+        profile.min_window_charge = std::min(profile.min_window_charge, average);
+    });
+    return profile;
+}
+
+void SlidingWindowAverage(std::string_view protein, AminoAcidProperty property, int window, std::vector<float>& out) {
+    out.clear();
+    ForEachWindow(protein, property, window, [&](float average) {
+        out.push_back(average);
+    });
+}
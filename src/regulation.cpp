@@ -0,0 +1,278 @@
+#include "headers/regulation.hpp"
+
+#include <math.h>
+#include <algorithm>
+#include <tuple>
+
+const uint64_t LOW_BITS = 0x5555555555555555ull;
+
+MotifScanner::MotifScanner(const std::vector<Promoter>& promoters, const std::vector<Inhibitor>& inhibitors, int max_mismatches) {
+    next.push_back({-1, -1, -1, -1});
+    state_pieces.emplace_back();
+    std::string reverse;
+    for (size_t i = 0; i < promoters.size(); i++) {
+        const Promoter& promoter = promoters[i];
+        Pattern pattern = {MotifKind::PROMOTER, (int)i, false, 0, max_mismatches, (float)promoter.strength, (float)(1.0 - promoter.specificity), {}, {}};
+        AddPattern(pattern, promoter.sequence);
+        ReverseComplement(promoter.sequence, reverse);
+        // a palindrome would find every site twice
+        if (reverse != promoter.sequence) {
+            pattern.minus = true;
+            AddPattern(pattern, reverse);
+        }
+    }
+    for (size_t i = 0; i < inhibitors.size(); i++) {
+        const Inhibitor& inhibitor = inhibitors[i];
+        float weight = (float)(inhibitor.inhibition_strength * inhibitor.binding_affinity);
+        Pattern pattern = {MotifKind::INHIBITOR, (int)i, false, 0, max_mismatches, weight, (float)inhibitor.binding_affinity, {}, {}};
+        AddPattern(pattern, inhibitor.sequence);
+        ReverseComplement(inhibitor.sequence, reverse);
+        if (reverse != inhibitor.sequence) {
+            pattern.minus = true;
+            AddPattern(pattern, reverse);
+        }
+    }
+    Build();
+}
+
+void MotifScanner::AddPattern(Pattern pattern, const std::string& sequence) {
+    int length = (int)sequence.size();
+    if (length == 0) {
+        return;
+    }
+    pattern.length = length;
+    max_length = std::max(max_length, length);
+    pattern.max_mismatches = std::min(pattern.max_mismatches, length / MOTIF_BASES_PER_MISMATCH);
+    // every piece of at least MOTIF_MIN_PIECE bases, or else the shift-and
+    int piece_mismatches = length / MOTIF_MIN_PIECE - 1;
+    bool use_shift_and = pattern.max_mismatches > piece_mismatches && length <= MOTIF_SHIFT_LENGTH;
+    if (use_shift_and) {
+        pattern.max_mismatches = std::min(pattern.max_mismatches, length - 1);
+    }
+    else {
+        pattern.max_mismatches = std::max(0, std::min(pattern.max_mismatches, piece_mismatches));
+    }
+    int chunks = (length + BASES_PER_WORD - 1) / BASES_PER_WORD;
+    pattern.bases.assign(chunks, 0);
+    pattern.unknown.assign(chunks, 0);
+    std::vector<int> codes(length);
+    for (int i = 0; i < length; i++) {
+        int chunk = i / BASES_PER_WORD;
+        int chunk_length = std::min<int>(BASES_PER_WORD, length - chunk * BASES_PER_WORD);
+        int shift = 2 * (chunk_length - 1 - i % BASES_PER_WORD);
+        uint8_t code;
+        if (EncodeBase(sequence[i], code)) {
+            pattern.bases[chunk] |= (uint64_t)code << shift;
+            codes[i] = code;
+        }
+        else {
+            pattern.unknown[chunk] |= 1ull << shift;
+            codes[i] = -1;
+        }
+    }
+    int index = (int)patterns.size();
+    patterns.push_back(pattern);
+    if (use_shift_and) {
+        AddShiftPattern(index, codes);
+        return;
+    }
+
+    int piece_count = pattern.max_mismatches + 1;
+    for (int p = 0; p < piece_count; p++) {
+        int begin = p * length / piece_count;
+        int end = (p + 1) * length / piece_count;
+        // a piece with an unknown letter never matches exactly, one of the
+        // other pieces has to
+        if (std::any_of(codes.begin() + begin, codes.begin() + end, [](int code) { return code < 0; })) {
+            continue;
+        }
+        int state = 0;
+        for (int i = begin; i < end; i++) {
+            if (next[state][codes[i]] < 0) {
+                next[state][codes[i]] = (int)next.size();
+                next.push_back({-1, -1, -1, -1});
+                state_pieces.emplace_back();
+            }
+            state = next[state][codes[i]];
+        }
+        state_pieces[state].push_back((int)pieces.size());
+        pieces.push_back(Piece{index, begin, end - begin});
+    }
+}
+
+void MotifScanner::AddShiftPattern(int index, const std::vector<int>& codes) {
+    const Pattern& pattern = patterns[index];
+    if (shift_groups.empty() || shift_groups.back().used + pattern.length > MOTIF_SHIFT_LENGTH) {
+        shift_groups.emplace_back();
+        ShiftGroup& group = shift_groups.back();
+        group.masks.fill(0);
+        group.starts = 0;
+        group.finals = 0;
+        group.used = 0;
+        group.max_mismatches = 0;
+        group.final_pattern.fill(-1);
+    }
+    ShiftGroup& group = shift_groups.back();
+    int first = group.used;
+    for (int i = 0; i < pattern.length; i++) {
+        if (codes[i] >= 0) {
+            group.masks[codes[i]] |= 1ull << (first + i);
+        }
+    }
+    int last = first + pattern.length - 1;
+    group.starts |= 1ull << first;
+    group.finals |= 1ull << last;
+    group.final_pattern[last] = index;
+    group.used += pattern.length;
+    group.max_mismatches = std::max(group.max_mismatches, pattern.max_mismatches);
+    shift_mismatches = std::max(shift_mismatches, group.max_mismatches);
+}
+
+double MotifScanner::ChanceWeight(MotifKind kind, size_t length) const {
+    double total = 0;
+    for (const Pattern& pattern : patterns) {
+        if (pattern.kind != kind || length < (size_t)pattern.length) {
+            continue;
+        }
+        // chance of exactly j mismatches at one position is C(n, j) 3^j / 4^n
+        double ways = 1;
+        double weight = 0;
+        for (int j = 0; j <= pattern.max_mismatches; j++) {
+            weight += ways * pattern.weight * pow(pattern.mismatch_factor, j);
+            ways *= 3.0 * (pattern.length - j) / (j + 1);
+        }
+        total += (length - pattern.length + 1) * weight / pow(4.0, pattern.length);
+    }
+    return total;
+}
+
+void MotifScanner::Build() {
+    fail.assign(next.size(), 0);
+    output_link.assign(next.size(), -1);
+    std::vector<int> queue;
+    for (int code = 0; code < 4; code++) {
+        if (next[0][code] < 0) {
+            next[0][code] = 0;
+        }
+        else {
+            queue.push_back(next[0][code]);
+        }
+    }
+    // breadth first, so the failure target of a state is always finished before it
+    for (size_t q = 0; q < queue.size(); q++) {
+        int state = queue[q];
+        int link = fail[state];
+        output_link[state] = state_pieces[link].empty() ? output_link[link] : link;
+        for (int code = 0; code < 4; code++) {
+            int child = next[state][code];
+            if (child < 0) {
+                next[state][code] = next[link][code];
+            }
+            else {
+                fail[child] = next[link][code];
+                queue.push_back(child);
+            }
+        }
+    }
+}
+
+int MotifScanner::Mismatches(const PackedSequence& sequence, const Pattern& pattern, size_t start) const {
+    int count = 0;
+    int chunks = (int)pattern.bases.size();
+    for (int chunk = 0; chunk < chunks && count <= pattern.max_mismatches; chunk++) {
+        int chunk_length = std::min<int>(BASES_PER_WORD, pattern.length - chunk * BASES_PER_WORD);
+        uint64_t diff = sequence.Extract(start + chunk * BASES_PER_WORD, chunk_length) ^ pattern.bases[chunk];
+        count += __builtin_popcountll(((diff | (diff >> 1)) & LOW_BITS) | pattern.unknown[chunk]);
+    }
+    if (count > pattern.max_mismatches || !sequence.AnyAmbiguous(start, pattern.length)) {
+        return count;
+    }
+    // an N in the genome is stored as an A, so count it by hand
+    for (int i = 0; i < pattern.length; i++) {
+        if (sequence.IsAmbiguous(start + i)) {
+            int chunk = i / BASES_PER_WORD;
+            int chunk_length = std::min<int>(BASES_PER_WORD, pattern.length - chunk * BASES_PER_WORD);
+            int shift = 2 * (chunk_length - 1 - i % BASES_PER_WORD);
+            bool unknown = (pattern.unknown[chunk] >> shift) & 1;
+            bool was_match = !unknown && ((pattern.bases[chunk] >> shift) & 3) == sequence.Code(start + i);
+            count += was_match;
+        }
+    }
+    return count;
+}
+
+void MotifScanner::Scan(const PackedSequence& sequence, int fragment, size_t begin, size_t end, std::vector<MotifSite>& out, Arena& scratch) const {
+    size_t first = out.size();
+    end = std::min(end, sequence.size());
+    bool ambiguous = sequence.HasAmbiguous();
+    const std::vector<uint64_t>& words = sequence.Words();
+    int state = 0;
+    // rows[g * levels + j]: bit b is set where the bases of group g's
+    // patterns up to b end here with at most j mismatches
+    int levels = shift_mismatches + 1;
+    size_t row_count = shift_groups.size() * levels;
+    uint64_t* rows = scratch.Allocate<uint64_t>(row_count);
+    std::fill(rows, rows + row_count, 0);
+    for (size_t w = begin / BASES_PER_WORD; w * BASES_PER_WORD < end; w++) {
+        size_t i = std::max(begin, w * BASES_PER_WORD);
+        size_t word_end = std::min(end, (w + 1) * BASES_PER_WORD);
+        uint64_t bits = words[w] >> (2 * (i % BASES_PER_WORD));
+        for (; i < word_end; i++, bits >>= 2) {
+            int code = ambiguous && sequence.IsAmbiguous(i) ? 4 : (int)(bits & 3);
+            for (size_t g = 0; g < shift_groups.size(); g++) {
+                const ShiftGroup& group = shift_groups[g];
+                uint64_t* row = &rows[g * levels];
+                uint64_t mask = group.masks[code];
+                // a base either matches, or is spent as one more mismatch
+                for (int j = group.max_mismatches; j > 0; j--) {
+                    row[j] = (((row[j] << 1) | group.starts) & mask) | (row[j - 1] << 1) | group.starts;
+                }
+                row[0] = ((row[0] << 1) | group.starts) & mask;
+                for (uint64_t hits = row[group.max_mismatches] & group.finals; hits != 0; hits &= hits - 1) {
+                    int bit = __builtin_ctzll(hits);
+                    const Pattern& pattern = patterns[group.final_pattern[bit]];
+                    int mismatches = 0;
+                    while (!((row[mismatches] >> bit) & 1)) {
+                        mismatches++;
+                    }
+                    if (mismatches <= pattern.max_mismatches) {
+                        float weight = pattern.weight * powf(pattern.mismatch_factor, (float)mismatches);
+                        out.push_back(MotifSite{pattern.kind, pattern.motif, fragment, i + 1 - pattern.length, pattern.minus, mismatches, weight});
+                    }
+                }
+            }
+            if (code == 4) {
+                state = 0;
+                continue;
+            }
+            state = next[state][code];
+            for (int s = state_pieces[state].empty() ? output_link[state] : state; s > 0; s = output_link[s]) {
+                for (int id : state_pieces[s]) {
+                    const Piece& piece = pieces[id];
+                    const Pattern& pattern = patterns[piece.pattern];
+                    // the piece ends at i, the motif starts offset bases before the piece
+                    size_t piece_start = i + 1 - piece.length;
+                    if (piece_start < begin + piece.offset || piece_start - piece.offset + pattern.length > end) {
+                        continue;
+                    }
+                    size_t start = piece_start - piece.offset;
+                    int mismatches = Mismatches(sequence, pattern, start);
+                    if (mismatches <= pattern.max_mismatches) {
+                        float weight = pattern.weight * powf(pattern.mismatch_factor, (float)mismatches);
+                        out.push_back(MotifSite{pattern.kind, pattern.motif, fragment, start, pattern.minus, mismatches, weight});
+                    }
+                }
+            }
+        }
+    }
+    // a site with fewer than k mismatches is found through several of its pieces
+    auto key = [](const MotifSite& site) {
+        return std::make_tuple(site.position, site.kind, site.motif, site.minus);
+    };
+    std::sort(out.begin() + first, out.end(), [&](const MotifSite& a, const MotifSite& b) {
+        return key(a) < key(b);
+    });
+    out.erase(std::unique(out.begin() + first, out.end(), [&](const MotifSite& a, const MotifSite& b) {
+        return key(a) == key(b);
+    }), out.end());
+}
@@ -0,0 +1,134 @@
+#include "headers/render.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <math.h>
+
+void RectBatch::Add(const SDL_FRect& rect, SDL_FColor color) {
+    int first = (int)vertices.size();
+    vertices.push_back(SDL_Vertex{SDL_FPoint{rect.x, rect.y}, color, SDL_FPoint{0, 0}});
+    vertices.push_back(SDL_Vertex{SDL_FPoint{rect.x + rect.w, rect.y}, color, SDL_FPoint{0, 0}});
+    vertices.push_back(SDL_Vertex{SDL_FPoint{rect.x + rect.w, rect.y + rect.h}, color, SDL_FPoint{0, 0}});
+    vertices.push_back(SDL_Vertex{SDL_FPoint{rect.x, rect.y + rect.h}, color, SDL_FPoint{0, 0}});
+    if (indices.size() < size() * 6) {
+        indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    }
+}
+
+void RectBatch::Submit(SDL_Renderer* renderer) {
+    if (!vertices.empty()) {
+        SDL_RenderGeometry(renderer, nullptr, vertices.data(), (int)vertices.size(), indices.data(), (int)size() * 6);
+    }
+    vertices.clear();
+}
+
+TerrainLayer::TerrainLayer(int width, int height, int tile_width, int tile_height)
+    : width(width), height(height), tile_width(tile_width), tile_height(tile_height) {
+    chunk_columns = (width + TERRAIN_CHUNK_TILES - 1) / TERRAIN_CHUNK_TILES;
+    for (int y = 0; y < height; y += TERRAIN_CHUNK_TILES) {
+        for (int x = 0; x < width; x += TERRAIN_CHUNK_TILES) {
+            int columns = std::min(TERRAIN_CHUNK_TILES, width - x);
+            int rows = std::min(TERRAIN_CHUNK_TILES, height - y);
+            chunks.push_back(Chunk{x, y, columns, rows, nullptr, true, {}});
+        }
+    }
+}
+
+TerrainLayer::~TerrainLayer() {
+    Release();
+}
+
+void TerrainLayer::Release() {
+    for (Chunk& chunk : chunks) {
+        if (chunk.texture != nullptr) {
+            SDL_DestroyTexture(chunk.texture);
+            chunk.texture = nullptr;
+        }
+        // the next Update recreates the texture and draws it from scratch
+        chunk.all_dirty = true;
+        chunk.dirty.clear();
+    }
+}
+
+size_t TerrainLayer::ChunkOf(int tile) const {
+    return (tile % width) / TERRAIN_CHUNK_TILES + (tile / width) / TERRAIN_CHUNK_TILES * chunk_columns;
+}
+
+void TerrainLayer::MarkDirty(int tile) {
+    Chunk& chunk = chunks[ChunkOf(tile)];
+    if (!chunk.all_dirty) {
+        chunk.dirty.push_back(tile);
+    }
+}
+
+void TerrainLayer::MarkAllDirty() {
+    for (Chunk& chunk : chunks) {
+        chunk.all_dirty = true;
+        chunk.dirty.clear();
+    }
+}
+
+bool TerrainLayer::CreateChunkTexture(SDL_Renderer* renderer, size_t c) {
+    Chunk& chunk = chunks[c];
+    chunk.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, chunk.columns * tile_width, chunk.rows * tile_height);
+    if (chunk.texture == nullptr) {
+        printf("failed to create terrain chunk, %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureScaleMode(chunk.texture, SDL_SCALEMODE_NEAREST);
+    // a fresh texture holds garbage, so the whole chunk has to be drawn
+    chunk.all_dirty = true;
+    return true;
+}
+
+void TerrainLayer::Draw(SDL_Renderer* renderer, const Camera& camera, const SDL_FRect& visible) const {
+    for (const Chunk& chunk : chunks) {
+        if (chunk.texture == nullptr) {
+            continue;
+        }
+        SDL_FRect world{(float)chunk.x * tile_width, (float)chunk.y * tile_height, (float)chunk.columns * tile_width, (float)chunk.rows * tile_height};
+        if (!SDL_HasRectIntersectionFloat(&world, &visible)) {
+            continue;
+        }
+        SDL_FRect dst = camera.ToScreen(world);
+        SDL_RenderTexture(renderer, chunk.texture, nullptr, &dst);
+    }
+}
+
+void Camera::ZoomAt(float factor, float screen_x, float screen_y) {
+    float new_zoom = std::clamp(zoom * factor, 0.05f, 16.0f);
+    float world_x = x + screen_x / zoom;
+    float world_y = y + screen_y / zoom;
+    zoom = new_zoom;
+    x = world_x - screen_x / zoom;
+    y = world_y - screen_y / zoom;
+}
+
+void DrawDensity(RectBatch& batch, const SpatialGrid& grid, const Camera& camera, const SDL_FRect& visible) {
+    int cell_columns = (grid.columns + HEATMAP_CELL_TILES - 1) / HEATMAP_CELL_TILES;
+    int cell_rows = (grid.rows + HEATMAP_CELL_TILES - 1) / HEATMAP_CELL_TILES;
+    float cell_width = grid.cell_width * HEATMAP_CELL_TILES;
+    float cell_height = grid.cell_height * HEATMAP_CELL_TILES;
+    int x0 = std::max(0, (int)floorf(visible.x / cell_width));
+    int y0 = std::max(0, (int)floorf(visible.y / cell_height));
+    int x1 = std::min(cell_columns - 1, (int)floorf((visible.x + visible.w) / cell_width));
+    int y1 = std::min(cell_rows - 1, (int)floorf((visible.y + visible.h) / cell_height));
+    // a cell with every tile holding one entry is drawn fully opaque
+    const float full = HEATMAP_CELL_TILES * HEATMAP_CELL_TILES;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            int count = 0;
+            for (int row = y * HEATMAP_CELL_TILES; row < std::min(grid.rows, (y + 1) * HEATMAP_CELL_TILES); row++) {
+                for (int column = x * HEATMAP_CELL_TILES; column < std::min(grid.columns, (x + 1) * HEATMAP_CELL_TILES); column++) {
+                    count += grid.CellCount(column, row);
+                }
+            }
+            if (count == 0) {
+                continue;
+            }
+            float density = std::min(1.0f, count / full);
+            SDL_FRect world{x * cell_width, y * cell_height, cell_width, cell_height};
+            batch.Add(camera.ToScreen(world), SDL_FColor{1.0f, 1.0f - density, 0.0f, 0.25f + 0.6f * density});
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "headers/rng.hpp"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNG_X86
+#include <immintrin.h>
+#endif
+
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+const int PHILOX_ROUNDS = 10;
+
+// the stream lives in the top 16 bits of the counter, leaving 48 bits of ticks
+static void PhiloxCounter(RngStream stream, uint64_t tick, uint64_t index, uint32_t ctr[4]) {
+    ctr[0] = (uint32_t)index;
+    ctr[1] = (uint32_t)(index >> 32);
+    ctr[2] = (uint32_t)tick;
+    ctr[3] = (uint32_t)((tick >> 32) & 0xFFFF) | ((uint32_t)stream << 16);
+}
+
+static RngBlock Philox4x32(const uint32_t ctr_in[4], uint64_t seed) {
+    uint32_t c0 = ctr_in[0], c1 = ctr_in[1], c2 = ctr_in[2], c3 = ctr_in[3];
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return RngBlock{{c0, c1, c2, c3}};
+}
+
+RngBlock CounterRng::Block(RngStream stream, uint64_t tick, uint64_t index) const {
+    uint32_t ctr[4];
+    PhiloxCounter(stream, tick, index, ctr);
+    return Philox4x32(ctr, seed);
+}
+
+static void FillBlocksScalar(uint64_t seed, RngStream stream, uint64_t tick, uint64_t first, uint32_t* out, size_t count) {
+    for (size_t j = 0; j < count; j++) {
+        uint32_t ctr[4];
+        PhiloxCounter(stream, tick, first + j, ctr);
+        RngBlock block = Philox4x32(ctr, seed);
+        for (int w = 0; w < 4; w++) {
+            out[4 * j + w] = block.w[w];
+        }
+    }
+}
+
+#ifdef RNG_X86
+// 32x32 -> 64 bit products of all 8 lanes, split into high and low halves
+__attribute__((target("avx2")))
+static inline void MulHiLo(__m256i a, __m256i m, __m256i& hi, __m256i& lo) {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// eight counters per iteration, one per lane
+__attribute__((target("avx2")))
+static void FillBlocksAVX2(uint64_t seed, RngStream stream, uint64_t tick, uint64_t first, uint32_t* out, size_t count) {
+    const __m256i m0 = _mm256_set1_epi32((int)PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32((int)PHILOX_M1);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        alignas(32) uint32_t lanes[4][8];
+        for (int l = 0; l < 8; l++) {
+            uint32_t ctr[4];
+            PhiloxCounter(stream, tick, first + j + l, ctr);
+            for (int w = 0; w < 4; w++) {
+                lanes[w][l] = ctr[w];
+            }
+        }
+        __m256i c0 = _mm256_load_si256((const __m256i*)lanes[0]);
+        __m256i c1 = _mm256_load_si256((const __m256i*)lanes[1]);
+        __m256i c2 = _mm256_load_si256((const __m256i*)lanes[2]);
+        __m256i c3 = _mm256_load_si256((const __m256i*)lanes[3]);
+        uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            __m256i hi0, lo0, hi1, lo1;
+            MulHiLo(c0, m0, hi0, lo0);
+            MulHiLo(c2, m1, hi1, lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int)k0));
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int)k1));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        _mm256_store_si256((__m256i*)lanes[0], c0);
+        _mm256_store_si256((__m256i*)lanes[1], c1);
+        _mm256_store_si256((__m256i*)lanes[2], c2);
+        _mm256_store_si256((__m256i*)lanes[3], c3);
+        for (int l = 0; l < 8; l++) {
+            for (int w = 0; w < 4; w++) {
+                out[4 * (j + l) + w] = lanes[w][l];
+            }
+        }
+    }
+    FillBlocksScalar(seed, stream, tick, first + j, out + 4 * j, count - j);
+}
+#endif
+
+typedef void (*FillBlocksKernel)(uint64_t seed, RngStream stream, uint64_t tick, uint64_t first, uint32_t* out, size_t count);
+
+static FillBlocksKernel SelectFillBlocks() {
+#ifdef RNG_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return FillBlocksAVX2;
+    }
+#endif
+    return FillBlocksScalar;
+}
+
+static const FillBlocksKernel fill_blocks = SelectFillBlocks();
+
+void CounterRng::FillBlocks(RngStream stream, uint64_t tick, uint64_t first, uint32_t* out, size_t count) const {
+    fill_blocks(seed, stream, tick, first, out, count);
+}
+
+void CounterRng::FillUniform(RngStream stream, uint64_t tick, uint64_t first, float* out, size_t count) const {
+    // the float array doubles as the word buffer, each word is converted in place
+    fill_blocks(seed, stream, tick, first, (uint32_t*)out, count);
+    for (size_t i = 0; i < 4 * count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &out[i], sizeof(bits));
+        out[i] = UniformFloat(bits);
+    }
+}
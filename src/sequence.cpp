@@ -0,0 +1,286 @@
+#include "headers/sequence.hpp"
+
+#include <algorithm>
+
+// reverses the order of the 32 2-bit groups in a word
+static uint64_t Reverse2(uint64_t x) {
+    x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+    return __builtin_bswap64(x);
+}
+
+static uint64_t BaseMask(size_t count) {
+    return count >= BASES_PER_WORD ? ~0ull : (1ull << (2 * count)) - 1;
+}
+
+// 32 bases starting at pos, base pos in the lowest bits, zero past the end
+static uint64_t Read32(const std::vector<uint64_t>& words, size_t pos) {
+    size_t index = pos / BASES_PER_WORD;
+    if (index >= words.size()) {
+        return 0;
+    }
+    int shift = 2 * (pos % BASES_PER_WORD);
+    uint64_t bits = words[index] >> shift;
+    if (shift != 0 && index + 1 < words.size()) {
+        bits |= words[index + 1] << (64 - shift);
+    }
+    return bits;
+}
+
+// appends count bases from bits (lowest first), the padding past the last
+// base always stays zero so whole words can be compared and shifted
+static void AppendBits(std::vector<uint64_t>& words, size_t& length, uint64_t bits, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    bits &= BaseMask(count);
+    size_t offset = length % BASES_PER_WORD;
+    if (offset == 0) {
+        words.push_back(bits);
+    }
+    else {
+        words.back() |= bits << (2 * offset);
+        if (offset + count > BASES_PER_WORD) {
+            words.push_back(bits >> (2 * (BASES_PER_WORD - offset)));
+        }
+    }
+    length += count;
+}
+
+PackedSequence::PackedSequence(std::string_view bases) : length(0), ambiguous_count(0) {
+    words.reserve((bases.size() + BASES_PER_WORD - 1) / BASES_PER_WORD);
+    Append(bases);
+}
+
+uint64_t PackedSequence::Extract(size_t pos, int count) const {
+    if (count <= 0) {
+        return 0;
+    }
+    return Reverse2(Read32(words, pos) & BaseMask(count)) >> (64 - 2 * count);
+}
+
+bool PackedSequence::AnyAmbiguous(size_t pos, size_t count) const {
+    if (ambiguous_count == 0) {
+        return false;
+    }
+    size_t end = std::min(pos + count, std::min(length, ambiguous.size() * 64));
+    for (size_t i = pos; i < end;) {
+        uint64_t word = ambiguous[i / 64] >> (i % 64);
+        if (word == 0) {
+            i = (i / 64 + 1) * 64;
+            continue;
+        }
+        return i + __builtin_ctzll(word) < end;
+    }
+    return false;
+}
+
+void PackedSequence::SetCode(size_t i, uint8_t code) {
+    uint64_t& word = words[i / BASES_PER_WORD];
+    int shift = 2 * (i % BASES_PER_WORD);
+    word = (word & ~(3ull << shift)) | ((uint64_t)code << shift);
+}
+
+void PackedSequence::SetAmbiguous(size_t i, bool value) {
+    if (value) {
+        // ambiguous bases are always stored as A so equal sequences have equal words
+        SetCode(i, BASE_A);
+        if (ambiguous.size() * 64 <= i) {
+            ambiguous.resize((length + 63) / 64);
+        }
+    }
+    else if (ambiguous.size() * 64 <= i) {
+        return;
+    }
+    uint64_t bit = 1ull << (i % 64);
+    bool was = ambiguous[i / 64] & bit;
+    if (value && !was) {
+        ambiguous[i / 64] |= bit;
+        ambiguous_count++;
+    }
+    else if (!value && was) {
+        ambiguous[i / 64] &= ~bit;
+        ambiguous_count--;
+    }
+}
+
+void PackedSequence::Append(char base) {
+    uint8_t code;
+    bool known = EncodeBase(base, code);
+    AppendBits(words, length, code, 1);
+    if (!known) {
+        SetAmbiguous(length - 1, true);
+    }
+}
+
+void PackedSequence::Append(std::string_view bases) {
+    size_t i = 0;
+    while (i < bases.size()) {
+        // pack up to a word of bases at a time, ambiguous ones are flagged afterwards
+        size_t first = length;
+        size_t count = std::min(bases.size() - i, BASES_PER_WORD);
+        uint64_t bits = 0;
+        uint64_t unknown = 0;
+        for (size_t j = 0; j < count; j++) {
+            uint8_t code;
+            if (!EncodeBase(bases[i + j], code)) {
+                unknown |= 1ull << j;
+            }
+            bits |= (uint64_t)code << (2 * j);
+        }
+        AppendBits(words, length, bits, count);
+        for (; unknown != 0; unknown &= unknown - 1) {
+            SetAmbiguous(first + __builtin_ctzll(unknown), true);
+        }
+        i += count;
+    }
+}
+
+void PackedSequence::AppendRange(PackedSequence& out, size_t pos, size_t count) const {
+    size_t first = out.length;
+    for (size_t done = 0; done < count; done += BASES_PER_WORD) {
+        AppendBits(out.words, out.length, Read32(words, pos + done), std::min(BASES_PER_WORD, count - done));
+    }
+    if (ambiguous_count == 0) {
+        return;
+    }
+    size_t end = std::min(pos + count, ambiguous.size() * 64);
+    for (size_t i = pos; i < end;) {
+        uint64_t word = ambiguous[i / 64] >> (i % 64);
+        if (word == 0) {
+            i = (i / 64 + 1) * 64;
+            continue;
+        }
+        i += __builtin_ctzll(word);
+        if (i < end) {
+            out.SetAmbiguous(first + i - pos, true);
+        }
+        i++;
+    }
+}
+
+PackedSequence PackedSequence::Substr(size_t pos, size_t count) const {
+    PackedSequence out;
+    if (pos >= length) {
+        return out;
+    }
+    count = std::min(count, length - pos);
+    out.words.reserve((count + BASES_PER_WORD - 1) / BASES_PER_WORD);
+    AppendRange(out, pos, count);
+    return out;
+}
+
+PackedSequence PackedSequence::ReverseComplement() const {
+    PackedSequence out;
+    out.words.reserve(words.size());
+    for (size_t end = length; end > 0;) {
+        size_t start = end >= BASES_PER_WORD ? end - BASES_PER_WORD : 0;
+        size_t count = end - start;
+        uint64_t bits = (Read32(words, start) ^ ~0ull) & BaseMask(count);
+        AppendBits(out.words, out.length, Reverse2(bits) >> (64 - 2 * count), count);
+        end = start;
+    }
+    for (size_t i = 0; ambiguous_count > 0 && i < length; i++) {
+        if (IsAmbiguous(i)) {
+            out.SetAmbiguous(length - 1 - i, true);
+        }
+    }
+    return out;
+}
+
+std::string PackedSequence::ToString() const {
+    std::string out(length, 'A');
+    Unpack(&out[0]);
+    return out;
+}
+
+void PackedSequence::Unpack(char* out) const {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = At(i);
+    }
+}
+
+void PackedSequence::Substitute(size_t pos, char base) {
+    uint8_t code;
+    if (EncodeBase(base, code)) {
+        SetCode(pos, code);
+        SetAmbiguous(pos, false);
+    }
+    else {
+        SetAmbiguous(pos, true);
+    }
+}
+
+void PackedSequence::Insert(size_t pos, std::string_view bases) {
+    pos = std::min(pos, length);
+    PackedSequence out;
+    out.words.reserve((length + bases.size() + BASES_PER_WORD - 1) / BASES_PER_WORD);
+    AppendRange(out, 0, pos);
+    out.Append(bases);
+    AppendRange(out, pos, length - pos);
+    *this = std::move(out);
+}
+
+void PackedSequence::Erase(size_t pos, size_t count) {
+    pos = std::min(pos, length);
+    count = std::min(count, length - pos);
+    PackedSequence out;
+    out.words.reserve(words.size());
+    AppendRange(out, 0, pos);
+    AppendRange(out, pos + count, length - pos - count);
+    *this = std::move(out);
+}
+
+static uint64_t HashWord(uint64_t hash, uint64_t word) {
+    hash ^= word;
+    hash *= 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t PackedSequence::Hash() const {
+    uint64_t hash = HashWord(0x243F6A8885A308D3ull, length);
+    for (uint64_t word : words) {
+        hash = HashWord(hash, word);
+    }
+    // the bitmap is sized lazily, so only the words with a flag set count
+    for (size_t i = 0; ambiguous_count > 0 && i < ambiguous.size(); i++) {
+        if (ambiguous[i] != 0) {
+            hash = HashWord(HashWord(hash, i), ambiguous[i]);
+        }
+    }
+    // murmur3's finalizer, so every input bit reaches every output bit
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    return hash ^ (hash >> 33);
+}
+
+bool PackedSequence::operator==(const PackedSequence& other) const {
+    if (length != other.length || ambiguous_count != other.ambiguous_count || words != other.words) {
+        return false;
+    }
+    // the bitmaps are sized lazily so one can be shorter than the other
+    size_t n = std::max(ambiguous.size(), other.ambiguous.size());
+    for (size_t i = 0; i < n; i++) {
+        uint64_t a = i < ambiguous.size() ? ambiguous[i] : 0;
+        uint64_t b = i < other.ambiguous.size() ? other.ambiguous[i] : 0;
+        if (a != b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReverseComplement(std::string_view bases, std::string& out) {
+    out.resize(bases.size());
+    ReverseComplement(bases, &out[0]);
+}
+
+void ReverseComplement(std::string_view bases, char* out) {
+    for (size_t i = 0; i < bases.size(); i++) {
+        uint8_t code;
+        char base = bases[bases.size() - 1 - i];
+        out[i] = EncodeBase(base, code) ? BASE_LETTERS[code ^ 3] : 'N';
+    }
+}
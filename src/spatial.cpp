@@ -0,0 +1,42 @@
+#include "headers/spatial.hpp"
+
+SpatialGrid::SpatialGrid(int columns, int rows, float cell_width, float cell_height)
+    : columns(columns), rows(rows), cell_width(cell_width), cell_height(cell_height),
+      cell_start(columns * rows + 1), max_width(0), max_height(0) {}
+
+void SpatialGrid::Clear() {
+    staged.clear();
+    staged_cell.clear();
+    entries.clear();
+    max_width = 0;
+    max_height = 0;
+}
+
+void SpatialGrid::Insert(uint64_t id, const SDL_FRect& rect) {
+    staged.push_back(Entry{id, rect});
+    staged_cell.push_back(Column(rect.x) + Row(rect.y) * columns);
+    max_width = std::max(max_width, rect.w);
+    max_height = std::max(max_height, rect.h);
+}
+
+void SpatialGrid::Build() {
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+    for (int cell : staged_cell) {
+        cell_start[cell + 1]++;
+    }
+    for (size_t i = 1; i < cell_start.size(); i++) {
+        cell_start[i] += cell_start[i - 1];
+    }
+    // cell_start[cell] doubles as the write cursor and ends up one cell ahead,
+    // shifting it back afterwards restores the starts
+    entries.resize(staged.size());
+    for (size_t i = 0; i < staged.size(); i++) {
+        entries[cell_start[staged_cell[i]]++] = staged[i];
+    }
+    for (size_t i = cell_start.size() - 1; i > 0; i--) {
+        cell_start[i] = cell_start[i - 1];
+    }
+    cell_start[0] = 0;
+    staged.clear();
+    staged_cell.clear();
+}
@@ -0,0 +1,112 @@
+#include "headers/traitworker.hpp"
+
+#include <algorithm>
+
+TraitWorker::TraitWorker(const TraitMatcher& matcher, AlignmentCache& cache) : matcher(matcher), cache(cache) {
+    thread = std::thread(&TraitWorker::Loop, this);
+}
+
+TraitWorker::~TraitWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void TraitWorker::Submit(TraitBatch batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::make_unique<TraitBatch>(std::move(batch)));
+    }
+    wake.notify_one();
+}
+
+bool TraitWorker::Collect(uint64_t tick, TraitBatch& out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queue.empty() || queue.front()->tick > tick) {
+        return false;
+    }
+    done.wait(lock, [this] { return finished > 0; });
+    out = std::move(*queue.front());
+    queue.pop_front();
+    finished--;
+    return true;
+}
+
+size_t TraitWorker::Pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+void TraitWorker::Loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || finished < queue.size(); });
+        if (stopping) {
+            return;
+        }
+        // Collect only takes finished batches, so this one stays queued
+        // while the lock is released
+        TraitBatch* batch = queue[finished].get();
+        lock.unlock();
+        Match(*batch);
+        lock.lock();
+        finished++;
+        done.notify_all();
+    }
+}
+
+void TraitWorker::Match(TraitBatch& batch) {
+    size_t count = batch.genes.size();
+    uint64_t* keys = scratch.Allocate<uint64_t>(count);
+    int* order = scratch.Allocate<int>(count);
+    for (size_t g = 0; g < count; g++) {
+        keys[g] = batch.genes[g]->Hash();
+        order[g] = (int)g;
+    }
+    // copies of one gene side by side, the first of them leads
+    std::sort(order, order + count, [&](int a, int b) {
+        return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+    });
+    int* leader = scratch.Allocate<int>(count);
+    for (size_t i = 0; i < count; i++) {
+        leader[order[i]] = i > 0 && keys[order[i]] == keys[order[i - 1]] ? leader[order[i - 1]] : order[i];
+    }
+
+    // genes missing from the cache, each distinct gene aligned once however
+    // many organisms of the batch carry it
+    int* gene_miss = scratch.Allocate<int>(count);
+    ArenaVector<uint64_t> miss_keys{ArenaAllocator<uint64_t>(scratch)};
+    queries.clear();
+    batch.hits.assign(count, {});
+    for (size_t g = 0; g < count; g++) {
+        gene_miss[g] = -1;
+        if (leader[g] != (int)g) {
+            gene_miss[g] = gene_miss[leader[g]];
+            if (gene_miss[g] < 0) {
+                batch.hits[g] = batch.hits[leader[g]];
+            }
+        }
+        else if (!cache.Find(keys[g], batch.hits[g])) {
+            gene_miss[g] = (int)queries.size();
+            const PackedSequence& gene = *batch.genes[g];
+            char* bases = scratch.Allocate<char>(gene.size());
+            gene.Unpack(bases);
+            queries.push_back(std::string_view(bases, gene.size()));
+            miss_keys.push_back(keys[g]);
+        }
+    }
+
+    matcher.AlignBatch(queries, aligned, scratch);
+    for (size_t m = 0; m < queries.size(); m++) {
+        cache.Insert(miss_keys[m], aligned[m]);
+    }
+    for (size_t g = 0; g < count; g++) {
+        if (gene_miss[g] >= 0) {
+            batch.hits[g] = aligned[gene_miss[g]];
+        }
+    }
+    scratch.Reset();
+}
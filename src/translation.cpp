@@ -0,0 +1,167 @@
+#include "headers/translation.hpp"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSLATION_X86
+#include <immintrin.h>
+#endif
+
+// placeholder index for a codon containing an ambiguous base
+const uint8_t CODON_AMBIGUOUS = 0xFF;
+// codons pulled out of one 30 base window
+const int CODONS_PER_WINDOW = 10;
+
+// codons of a frame over length bases
+static size_t CodonCount(size_t length, int frame) {
+    size_t offset = frame % 3;
+    return length > offset ? (length - offset) / 3 : 0;
+}
+
+// writes the codon index of every codon in the frame of [begin, end) into out as one byte each
+static void GatherCodons(const PackedSequence& sequence, size_t begin, size_t end, int frame, char* out) {
+    size_t length = end - begin;
+    size_t offset = frame % 3;
+    size_t count = CodonCount(length, frame);
+    bool reverse = frame >= 3;
+    // forward position of the first base of codon j, read on the reverse
+    // strand the codon runs backwards from the end
+    auto position = [&](size_t j) {
+        return begin + (reverse ? length - offset - 3 * (j + 1) : offset + 3 * j);
+    };
+    size_t j = 0;
+    for (; j + CODONS_PER_WINDOW <= count; j += CODONS_PER_WINDOW) {
+        size_t first = reverse ? position(j + CODONS_PER_WINDOW - 1) : position(j);
+        uint64_t window = sequence.Extract(first, 3 * CODONS_PER_WINDOW);
+        for (int m = 0; m < CODONS_PER_WINDOW; m++) {
+            int codon = (window >> (6 * (CODONS_PER_WINDOW - 1 - m))) & 63;
+            if (reverse) {
+                out[j + CODONS_PER_WINDOW - 1 - m] = (char)ReverseComplementCodon(codon);
+            }
+            else {
+                out[j + m] = (char)codon;
+            }
+        }
+    }
+    for (; j < count; j++) {
+        int codon = (int)sequence.Extract(position(j), 3);
+        out[j] = (char)(reverse ? ReverseComplementCodon(codon) : codon);
+    }
+    if (sequence.HasAmbiguous()) {
+        for (size_t k = 0; k < count; k++) {
+            if (sequence.AnyAmbiguous(position(k), 3)) {
+                out[k] = (char)CODON_AMBIGUOUS;
+            }
+        }
+    }
+}
+
+// replaces codon indices with amino acids in place
+static void LookupScalar(char* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t codon = (uint8_t)data[i];
+        data[i] = codon == CODON_AMBIGUOUS ? UNKNOWN_AMINO_ACID : CODON_AMINO_ACIDS[codon];
+    }
+}
+
+#ifdef TRANSLATION_X86
+// the 64 entry table is four 16 byte shuffles, the high nibble picks which one applies
+__attribute__((target("ssse3")))
+static void LookupSSSE3(char* data, size_t count) {
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    const __m128i unknown = _mm_set1_epi8(UNKNOWN_AMINO_ACID);
+    const __m128i ambiguous = _mm_set1_epi8((char)CODON_AMBIGUOUS);
+    __m128i tables[4];
+    for (int t = 0; t < 4; t++) {
+        tables[t] = _mm_loadu_si128((const __m128i*)(CODON_AMINO_ACIDS.data() + 16 * t));
+    }
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i codons = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i low = _mm_and_si128(codons, low_nibble);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(codons, 4), low_nibble);
+        __m128i result = _mm_setzero_si128();
+        for (int t = 0; t < 4; t++) {
+            __m128i selected = _mm_cmpeq_epi8(high, _mm_set1_epi8((char)t));
+            result = _mm_or_si128(result, _mm_and_si128(selected, _mm_shuffle_epi8(tables[t], low)));
+        }
+        __m128i is_ambiguous = _mm_cmpeq_epi8(codons, ambiguous);
+        result = _mm_or_si128(_mm_andnot_si128(is_ambiguous, result), _mm_and_si128(is_ambiguous, unknown));
+        _mm_storeu_si128((__m128i*)(data + i), result);
+    }
+    LookupScalar(data + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void LookupAVX2(char* data, size_t count) {
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i unknown = _mm256_set1_epi8(UNKNOWN_AMINO_ACID);
+    const __m256i ambiguous = _mm256_set1_epi8((char)CODON_AMBIGUOUS);
+    __m256i tables[4];
+    for (int t = 0; t < 4; t++) {
+        tables[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(CODON_AMINO_ACIDS.data() + 16 * t)));
+    }
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i codons = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i low = _mm256_and_si256(codons, low_nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(codons, 4), low_nibble);
+        __m256i result = _mm256_setzero_si256();
+        for (int t = 0; t < 4; t++) {
+            __m256i selected = _mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)t));
+            result = _mm256_or_si256(result, _mm256_and_si256(selected, _mm256_shuffle_epi8(tables[t], low)));
+        }
+        __m256i is_ambiguous = _mm256_cmpeq_epi8(codons, ambiguous);
+        result = _mm256_blendv_epi8(result, unknown, is_ambiguous);
+        _mm256_storeu_si256((__m256i*)(data + i), result);
+    }
+    LookupScalar(data + i, count - i);
+}
+#endif
+
+typedef void (*LookupKernel)(char* data, size_t count);
+
+static LookupKernel SelectLookupKernel() {
+#ifdef TRANSLATION_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return LookupAVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return LookupSSSE3;
+    }
+#endif
+    return LookupScalar;
+}
+
+static const LookupKernel lookup_codons = SelectLookupKernel();
+
+const char* TranslationKernelName() {
+#ifdef TRANSLATION_X86
+    if (lookup_codons == LookupAVX2) {
+        return "avx2";
+    }
+    if (lookup_codons == LookupSSSE3) {
+        return "ssse3";
+    }
+#endif
+    return "scalar";
+}
+
+void Translate(const PackedSequence& sequence, int frame, std::string& out) {
+    out.resize(CodonCount(sequence.size(), frame));
+    GatherCodons(sequence, 0, sequence.size(), frame, &out[0]);
+    lookup_codons(&out[0], out.size());
+}
+
+size_t TranslateRange(const PackedSequence& sequence, size_t begin, size_t end, int frame, char* out) {
+    size_t count = CodonCount(end - begin, frame);
+    GatherCodons(sequence, begin, end, frame, out);
+    lookup_codons(out, count);
+    return count;
+}
+
+void TranslateAllFrames(const PackedSequence& sequence, std::array<std::string, READING_FRAMES>& out) {
+    for (int frame = 0; frame < READING_FRAMES; frame++) {
+        Translate(sequence, frame, out[frame]);
+    }
+}
@@ -0,0 +1,88 @@
+#include "headers/workers.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int thread_count) : job(nullptr), job_size(0), generation(0), busy(0), stopping(false), next_task(0) {
+    for (int i = 1; i < thread_count; i++) {
+        threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+int WorkerPool::DefaultThreadCount() {
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void WorkerPool::RunTasks(int thread) {
+    for (int task = next_task.fetch_add(1); task < job_size; task = next_task.fetch_add(1)) {
+        (*job)(task, thread);
+    }
+}
+
+void WorkerPool::WorkerLoop(int thread) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        RunTasks(thread);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_one();
+    }
+}
+
+void WorkerPool::Run(int task_count, const Task& fn) {
+    if (task_count <= 0) {
+        return;
+    }
+    if (threads.empty() || task_count == 1) {
+        for (int task = 0; task < task_count; task++) {
+            fn(task, 0);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        job_size = task_count;
+        next_task = 0;
+        busy = (int)threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunTasks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0; });
+    job = nullptr;
+}
+
+void WorkerPool::ParallelFor(int count, int min_range, const std::function<void(int begin, int end, int thread)>& fn) {
+    if (count <= 0) {
+        return;
+    }
+    // a few ranges per thread so uneven ranges still balance out
+    int ranges = std::min(ThreadCount() * 4, std::max(1, count / std::max(1, min_range)));
+    Run(ranges, [&](int task, int thread) {
+        int begin = (int)((long long)count * task / ranges);
+        int end = (int)((long long)count * (task + 1) / ranges);
+        fn(begin, end, thread);
+    });
+}